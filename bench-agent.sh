@@ -0,0 +1,27 @@
+#!/bin/sh
+# Usage: ./bench-agent.sh [CYCLES]
+#
+# Runs src/agent-bench against src/mock-agent with no faults, with added
+# latency, with responses split into single bytes and with failures injected.
+
+set -e
+
+CYCLES=${1:-1000}
+SOCK=`mktemp -u`
+
+run() {
+	echo "== mock-agent $*"
+	src/mock-agent $SOCK "$@" &
+	pid=$!
+	while [ ! -S $SOCK ]; do sleep 0.1; done
+	SSH_AUTH_SOCK=$SOCK src/agent-bench $CYCLES 2>/dev/null || status=$?
+	kill $pid
+	wait $pid 2>/dev/null || true
+	rm -f $SOCK
+	return ${status:-0}
+}
+
+run
+run -l 200
+run -f 1
+run -e 7
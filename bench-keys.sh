@@ -0,0 +1,45 @@
+#!/bin/sh
+# Usage: ./bench-keys.sh BINARY...
+#
+# Lists the ssh keys of HOSTS hosts (default 2000) as tsv and prints the
+# average time per key with the portable and the cpu specific base64
+# encoder, without and with fingerprints. The key derivation is measured
+# separately and left out.
+
+set -e
+
+export SLPM_FULLNAME="John Doe"
+export SLPM_FORMAT=tsv
+unset SLPM_KEYRING_TIMEOUT SLPM_PERF
+HOSTS=${HOSTS:-2000}
+
+now() { date +%s%N; }
+
+hosts() {
+	echo "correct horse battery staple"
+	for i in `seq $1`; do
+		printf 'ssh host-%d.example\n1\n' $i
+	done
+}
+
+run() {
+	bin=$1
+	shift
+	start=`now`
+	hosts $HOSTS | env "$@" ssh-agent ./$bin > /dev/null 2>&1
+	echo $((`now` - start))
+}
+
+printf '%-24s %-9s %-12s %12s\n' binary backend fingerprint us-per-key
+for bin; do
+	start=`now`
+	hosts 0 | ssh-agent ./$bin > /dev/null 2>&1
+	kdf=$((`now` - start))
+	for backend in portable auto; do
+		for fp in 0 1; do
+			total=`run $bin SLPM_BACKEND=$backend SLPM_FINGERPRINT=$fp`
+			printf '%-24s %-9s %-12s %12d\n' $bin $backend $fp \
+				$(((total - kdf) / 1000 / HOSTS))
+		done
+	done
+done
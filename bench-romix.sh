@@ -0,0 +1,36 @@
+#!/bin/sh
+# Usage: ./bench-romix.sh BINARY...
+#
+# Prints the average key derivation time of every binary with each ROMix
+# mode (see SLPM_ROMIX) for the KDF profiles in PROFILES (default the two
+# lane profiles 0 and 3), in milliseconds. With CPUS set, e.g. CPUS=0, the
+# runs are pinned to those cpus to see what a single-core host gets.
+
+set -e
+
+export SLPM_FULLNAME="John Doe"
+unset SLPM_KEYRING_TIMEOUT SLPM_PERF SLPM_BACKEND
+RUNS=${RUNS:-5}
+PROFILES=${PROFILES:-0 3}
+
+now() { date +%s%N; }
+
+pin() {
+	if [ -n "$CPUS" ]; then taskset -c $CPUS "$@"; else "$@"; fi
+}
+
+printf '%-24s %-8s %12s %12s %12s %12s\n' binary profile reference sequential interleaved threaded
+for bin; do
+	for profile in $PROFILES; do
+		printf '%-24s %-8s' $bin $profile
+		for romix in reference sequential interleaved threaded; do
+			start=`now`
+			for i in `seq $RUNS`; do
+				echo "correct horse battery staple" | \
+					SLPM_KDF_PROFILE=$profile SLPM_ROMIX=$romix pin ./$bin > /dev/null 2>&1
+			done
+			printf ' %12d' $(((`now` - start) / 1000000 / RUNS))
+		done
+		echo
+	done
+done
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Usage: ./bench.sh BINARY...
+#
+# Prints the average exec-to-first-prompt time and the average time of a full
+# key derivation for every binary, in milliseconds.
+
+set -e
+
+export SLPM_FULLNAME="John Doe"
+unset SLPM_KEYRING_TIMEOUT
+RUNS=${RUNS:-10}
+
+now() { date +%s%N; }
+
+printf '%-24s %12s %12s\n' binary startup-ms kdf-ms
+for bin; do
+	start=`now`
+	for i in `seq $RUNS`; do
+		./$bin < /dev/null > /dev/null || true
+	done
+	startup=$(( (`now` - start) / RUNS ))
+
+	start=`now`
+	for i in `seq $RUNS`; do
+		echo "correct horse battery staple" | ./$bin > /dev/null
+	done
+	total=$(( (`now` - start) / RUNS ))
+
+	printf '%-24s %12d.%03d %12d.%03d\n' $bin \
+		$((startup / 1000000)) $((startup / 1000 % 1000)) \
+		$(((total - startup) / 1000000)) $(((total - startup) / 1000 % 1000))
+done
@@ -4,8 +4,11 @@ set -e
 
 export SLPM_FULLNAME="John Doe"
 export USER="jdoe"
-./expected-output.sh > expected.out
-ssh-agent ./slpm.comp << EOF | diff -u3 expected.out /dev/stdin
+
+for seed in hmac-sha256 blake2b; do
+	export SLPM_SEED=$seed
+	./expected-output.sh $seed > expected.out
+	ssh-agent ./slpm.comp << EOF | diff -u3 expected.out /dev/stdin
 correct horse battery staple
 twitter.com
 1
@@ -14,4 +17,5 @@ facebook.com
 ssh github.com
 1
 EOF
+done
 rm expected.out
@@ -0,0 +1,129 @@
+#!/bin/sh
+# Usage: ./corpus.sh generate REFERENCE > corpus.tsv
+#        ./corpus.sh check BINARY...
+#
+# corpus.tsv pins the records of every seed algorithm and a couple of KDF
+# profiles for a spread of names, passphrases, sites and counters, enough of
+# them to hit every template. "check" runs every binary once with the portable
+# backends and once per ROMix mode with the ones picked for this cpu, compares
+# the records with the corpus bit for bit and prints how long each run took.
+# The build variants of the Makefile are held to the records they support.
+
+set -e
+
+export USER="jdoe"
+unset SLPM_KEYRING_TIMEOUT SLPM_PERF SLPM_ROMIX
+
+long=`printf '%0200d' 0 | tr 0 x`
+
+# seed algorithm|KDF profile|full name|passphrase
+groups() {
+	cat << EOF2
+hmac-sha256|0|John Doe|correct horse battery staple
+blake2b|0|John Doe|correct horse battery staple
+hmac-sha256|0|Jöhn Dœ|pässwörd 🔑
+blake2b|0|Jöhn Dœ|pässwörd 🔑
+hmac-sha256|0|李小龙|
+blake2b|0|李小龙|
+hmac-sha256|0|x|$long
+blake2b|0|$long|x
+hmac-sha256|0|Doe: John|correct horse battery staple
+hmac-sha256|1|John Doe|correct horse battery staple
+blake2b|1|John Doe|correct horse battery staple
+EOF2
+}
+
+# site|counter
+sites() {
+	cat << EOF2
+twitter.com|1
+facebook.com|2
+ssh github.com|1
+ssh gitlab.com|3
+bücher.de|1
+例子.测试|1
+a site with spaces|1
+$long|1
+example.com|0
+example.com|1000
+example.com|2147483647
+EOF2
+	for i in `seq 16`; do
+		echo "site-$i.example|$i"
+	done
+}
+
+# the seed algorithms a binary supports, slpm-hmac and slpm-blake2b fix one
+seeds() {
+	case $1 in
+	*slpm-hmac*) echo hmac-sha256 ;;
+	*slpm-blake2b*) echo blake2b ;;
+	*) echo hmac-sha256 blake2b ;;
+	esac
+}
+
+# the records of the corpus a binary should reproduce, slpm-nossh has no keys
+expected() {
+	case $1 in
+	*slpm-nossh*) ssh=0 ;;
+	*) ssh=1 ;;
+	esac
+	awk -F '\t' -v seeds="`seeds $1`" -v ssh=$ssh '
+		BEGIN { split(seeds, s, " "); for (i in s) keep[s[i]] = 1 }
+		keep[$1] && (ssh || $7 != "ssh-ed25519")' corpus.tsv
+}
+
+run() {
+	case $1 in
+	*/*) bin=$1 ;;
+	*) bin=./$1 ;;
+	esac
+	seeds=" `seeds $bin` "
+	groups | while IFS='|' read -r seed profile name pw; do
+		case $seeds in
+		*" $seed "*) ;;
+		*) continue ;;
+		esac
+		{ echo "$pw"; sites | tr '|' '\n'; } |
+		SLPM_SEED=$seed SLPM_KDF_PROFILE=$profile SLPM_FULLNAME=$name SLPM_FORMAT=tsv \
+			ssh-agent $bin 2> /dev/null |
+		awk -v prefix="$seed	$profile	$name	$pw	" '{ print prefix $0 }'
+	done
+}
+
+now() { date +%s%N; }
+
+case $1 in
+generate)
+	SLPM_BACKEND=portable SLPM_ROMIX=reference run $2
+	;;
+check)
+	shift
+	rc=0
+	printf '%-24s %-9s %-12s %10s %s\n' binary backend romix ms result
+	for bin; do
+		expected $bin > corpus.expected
+		for mode in portable/reference auto/reference auto/sequential auto/interleaved auto/threaded; do
+			backend=${mode%/*}
+			romix=${mode#*/}
+			start=`now`
+			SLPM_BACKEND=$backend SLPM_ROMIX=$romix run $bin > corpus.out
+			ms=$(( (`now` - start) / 1000000 ))
+			if cmp -s corpus.expected corpus.out; then
+				result=ok
+			else
+				result=MISMATCH
+				rc=1
+				diff -u3 corpus.expected corpus.out | head -20 >&2
+			fi
+			printf '%-24s %-9s %-12s %10d %s\n' $bin $backend $romix $ms $result
+		done
+	done
+	rm -f corpus.expected corpus.out
+	exit $rc
+	;;
+*)
+	sed -n 's/^# \{0,1\}//; 2,3p' $0 >&2
+	exit 2
+	;;
+esac
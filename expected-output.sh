@@ -1,4 +1,28 @@
 #!/bin/sh
+case "$1" in
+blake2b)
+cat << EOF
+slpm `git describe --long`
+SLPM_FULLNAME='John Doe'
+SLPM_SEED=blake2b
+Passphrase: Deriving key...Key derivation complete.
+Site: Counter: Maximum Security Password: I9,vl2hTWl*FRNVWSiM!
+Long Password: Cugs3[QejaFize
+Medium Password: Cug9!Man
+Short Password: Cug9
+Basic Password: IFU9WpS1
+PIN: 6949
+Site: Counter: Maximum Security Password: wv2RfkKg&gUuHFWmMF5=
+Long Password: TuqlRidz2+Refo
+Medium Password: TuqLus3+
+Short Password: Tuq9
+Basic Password: wH49fVT1
+PIN: 4949
+Site: Counter: ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIDe5ZxDTJ2anF4Hy7pR2LYgdusx0O0WL5nA4mn0vePlm jdoe@slpm+github.com
+Site: Bye!    
+EOF
+;;
+*)
 cat << EOF
 slpm `git describe --long`
 SLPM_FULLNAME='John Doe'
@@ -18,3 +42,5 @@ PIN: 8763
 Site: Counter: ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIIuUymVj8nCcFfItW98tJNGMiLKV0dKso8UUFw6VME73 jdoe@slpm+github.com
 Site: Bye!    
 EOF
+;;
+esac
@@ -0,0 +1,110 @@
+// Drives SshAgent against the agent at SSH_AUTH_SOCK (normally mock-agent)
+// through cycles of filling the key ring, adding with eviction and tearing it
+// down, then prints latency percentiles per operation. A hosted helper for
+// bench-agent.sh, not part of slpm.
+//
+// Usage: agent-bench [CYCLES]
+
+#include "ssh-agent.h"
+#include "buffer.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+using Samples = std::vector<double>;
+
+static const int ring = 8;
+
+static double
+us_since(Clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+static Ed25519KeyPair
+make_key(uint32_t n)
+{
+	Ed25519KeyPair k{};
+	for (unsigned i = 0; i != k.pub.size(); i += 4) {
+		const uint32_t v = htonl(n * 2654435761u + i);
+		memcpy(k.pub.data() + i, &v, sizeof(v));
+	}
+	std::copy(k.pub.begin(), k.pub.end(), k.sec.begin() + 32);
+	return k;
+}
+
+// Asks the agent over a separate connection how many identities it holds.
+static long
+count_identities()
+{
+	const char* path = getenv("SSH_AUTH_SOCK");
+	Fd fd(socket(AF_UNIX, SOCK_STREAM, 0));
+	sockaddr_un sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, path ? path : "", sizeof(sa.sun_path) - 1);
+	if (!fd.valid() || connect(fd.get(), reinterpret_cast<sockaddr*>(&sa), sizeof(sa))) return -1;
+	const uint8_t req[] = { 0, 0, 0, 1, 11 }; // SSH2_AGENTC_REQUEST_IDENTITIES
+	if (write(fd.get(), req, sizeof(req)) != sizeof(req)) return -1;
+	uint8_t resp[9];
+	size_t got = 0;
+	while (got != sizeof(resp)) {
+		const ssize_t rd = read(fd.get(), resp + got, sizeof(resp) - got);
+		if (rd <= 0) return -1;
+		got += rd;
+	}
+	if (resp[4] != 12) return -1;
+	uint32_t n;
+	memcpy(&n, resp + 5, sizeof(n));
+	return ntohl(n);
+}
+
+static void
+report(const char* name, Samples& s)
+{
+	if (s.empty()) {
+		printf("%-10s %8d\n", name, 0);
+		return;
+	}
+	std::sort(s.begin(), s.end());
+	const auto at = [&](double q) { return s[std::min(s.size() - 1, static_cast<size_t>(q * s.size()))]; };
+	printf("%-10s %8zu %9.1f %9.1f %9.1f %9.1f\n", name, s.size(), at(0.5), at(0.9), at(0.99), s.back());
+}
+
+int
+main(int argc, char* argv[])
+{
+	const int cycles = argc > 1 ? atoi(argv[1]) : 1000;
+	Samples add, evict, remove;
+	unsigned failed = 0;
+	uint32_t n = 0;
+	for (int c = 0; c != cycles; ++c) {
+		SshAgent* sa = new SshAgent;
+		for (int i = 0; i != 2 * ring; ++i) {
+			const auto k = make_key(n++);
+			const auto start = Clock::now();
+			if (sa->add(k, "slpm+bench")) ++failed;
+			(i < ring ? add : evict).push_back(us_since(start));
+		}
+		while (true) {
+			const auto start = Clock::now();
+			if (!sa->remove_oldest()) break;
+			remove.push_back(us_since(start));
+		}
+		delete sa;
+	}
+
+	printf("%-10s %8s %9s %9s %9s %9s\n", "operation", "count", "p50-us", "p90-us", "p99-us", "max-us");
+	report("add", add);
+	report("add+evict", evict);
+	report("remove", remove);
+	printf("failed adds: %u, keys left in agent: %ld\n", failed, count_identities());
+	return 0;
+}
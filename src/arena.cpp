@@ -0,0 +1,90 @@
+#include "arena.h"
+
+#include "pool.h"
+#include "utils.h"
+
+#include <sys/mman.h>
+#include <cstdint>
+#include <algorithm>
+
+// deep enough for an ssh key being added while its record is formatted
+static const std::size_t capacity = 32 * 1024;
+
+// one per pool worker, the caller of pool_run and the main thread use the first
+struct Region {
+	uint8_t* base;
+	std::size_t top;
+	std::size_t high_water;
+};
+
+static Region regions[pool_max_workers];
+static bool lock_failed = false;
+// set by any thread, only ever from false to true
+static volatile bool exhausted = false;
+
+static bool
+lock_secret(void* p, std::size_t size)
+{
+	madvise(p, size, MADV_DONTDUMP);
+	return !mlock(p, size);
+}
+
+void*
+map_secret(std::size_t size, int flags)
+{
+	void *const p = map_anonymous(size, flags);
+	if (p) lock_secret(p, size);
+	return p;
+}
+
+static void
+map_region(Region& r)
+{
+	r.base = static_cast<uint8_t*>(map_anonymous(capacity, MAP_PRIVATE));
+	if (!r.base) {
+		writes(STDERR_FILENO, "Failed to map scratch arena\n");
+		return;
+	}
+	if (!lock_secret(r.base, capacity) && !lock_failed) {
+		lock_failed = true;
+		writes(STDERR_FILENO, "Failed to lock scratch arena, secrets may be swapped out\n");
+	}
+}
+
+void*
+arena_allocate(std::size_t size)
+{
+	auto& r = regions[pool_worker()];
+	if (!r.base) map_region(r);
+	size = (size + 15) & ~std::size_t(15);
+	if (!r.base || size > capacity - r.top) {
+		if (r.base && !exhausted) writes(STDERR_FILENO, "Scratch arena exhausted\n");
+		exhausted = true;
+		return nullptr;
+	}
+	void *const p = r.base + r.top;
+	r.top += size;
+	if (r.top > r.high_water) r.high_water = r.top;
+	return p;
+}
+
+// the owner wipes what it wrote, everything above top stays zero
+void
+arena_release(void* p)
+{
+	if (!p) return;
+	auto& r = regions[pool_worker()];
+	r.top = static_cast<uint8_t*>(p) - r.base;
+}
+
+bool arena_exhausted() { return exhausted; }
+
+std::size_t
+arena_high_water()
+{
+	std::size_t high = 0;
+	for (const auto& r : regions) high = std::max(high, r.high_water);
+	return high;
+}
+
+std::size_t arena_size() { return capacity; }
@@ -0,0 +1,72 @@
+#ifndef SLPM_ARENA_HEADER
+#define SLPM_ARENA_HEADER
+
+#include "buffer.h"
+
+#include <cstddef>
+
+// The buffers a query formats its secrets in are carved out of one region per
+// session and thread instead of the stack. It is locked, so it never reaches
+// swap, and left out of core dumps. Allocations are released in reverse order.
+// Once a region is exhausted allocations return nullptr, Scratch storage is
+// then empty, and arena_exhausted() stays true: whatever was computed since
+// must be dropped.
+void* arena_allocate(std::size_t size);
+void arena_release(void* p);
+bool arena_exhausted();
+std::size_t arena_high_water();
+std::size_t arena_size();
+
+// Maps memory for secrets too large for the arena, like the master keys or
+// scrypt's V, left out of core dumps and locked as a whole if it still fits
+// in RLIMIT_MEMLOCK. A mapping that does not fit is silently left unlocked.
+// Returns nullptr if it cannot be mapped.
+void* map_secret(std::size_t size, int flags);
+
+template <typename T, ptrdiff_t S>
+struct Scratch {
+	using iterator = T*;
+
+	Scratch() : p_(static_cast<T*>(arena_allocate(S * sizeof(T)))) {}
+	~Scratch() { arena_release(p_); }
+	Scratch(const Scratch&) = delete;
+	Scratch& operator=(const Scratch&) = delete;
+
+	T* data() { return p_; }
+	const T* data() const { return p_; }
+	T* begin() { return p_; }
+	const T* begin() const { return p_; }
+	T* end() { return p_ ? p_ + S : p_; }
+	const T* end() const { return p_ ? p_ + S : p_; }
+	ptrdiff_t size() const { return p_ ? S : 0; }
+
+private:
+	T* p_;
+};
+
+template <typename T, ptrdiff_t S>
+using ScratchBuffer = Buffer<T, S, Scratch<T, S>>;
+
+// A single secret, e.g. a seed or a key pair, wiped when it goes away. Check
+// valid() before using it.
+template <typename T>
+struct ScratchObject {
+	ScratchObject() : p_(static_cast<T*>(arena_allocate(sizeof(T)))) {}
+	~ScratchObject()
+	{
+		if (p_) sodium_memzero(p_, sizeof(T));
+		arena_release(p_);
+	}
+	ScratchObject(const ScratchObject&) = delete;
+	ScratchObject& operator=(const ScratchObject&) = delete;
+
+	bool valid() const { return p_; }
+	T& operator*() { return *p_; }
+	const T& operator*() const { return *p_; }
+	T* operator->() { return p_; }
+
+private:
+	T* p_;
+};
+
+#endif // SLPM_ARENA_HEADER
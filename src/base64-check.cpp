@@ -0,0 +1,67 @@
+// Compares the SSSE3 base64 encoder with the scalar one for every length
+// from 0 to 64 bytes, padded and unpadded, at every alignment of the input,
+// and checks neither writes past the characters it returns. A hosted helper
+// for make check, not part of slpm.
+//
+// Usage: base64-check
+
+#include "base64.h"
+
+#include <sodium/runtime.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+extern "C" int _sodium_runtime_get_cpu_features(void);
+
+static const int max_len = 64;
+static const int alignments = 16;
+// guard bytes after the characters an encoder may write
+static const int slack = 16;
+
+using Output = char[2][max_len + 1][alignments][max_len / 3 * 4 + 4 + slack];
+
+static uint8_t input[max_len + alignments];
+
+static bool
+encode_all(Output& out)
+{
+	bool ok = true;
+	for (int pad = 0; pad != 2; ++pad) {
+		for (int len = 0; len <= max_len; ++len) {
+			const std::size_t need = pad ? (len + 2) / 3 * 4 : (len * 4 + 2) / 3;
+			for (int a = 0; a != alignments; ++a) {
+				char* dst = out[pad][len][a];
+				memset(dst, '#', need + slack);
+				const ptrdiff_t n = base64_encode(dst, need, input + a, len, pad);
+				if (n != static_cast<ptrdiff_t>(need) || dst[need] != '#') {
+					printf("length %d, alignment %d, pad %d: wrote %td of %zu characters\n", len, a, pad, n, need);
+					ok = false;
+				}
+			}
+		}
+	}
+	return ok;
+}
+
+int
+main()
+{
+	for (unsigned i = 0; i != sizeof(input); ++i) input[i] = i * 167 + 13;
+	static Output scalar, simd;
+	// the encoder stays scalar until the cpu has been probed
+	bool ok = encode_all(scalar);
+	_sodium_runtime_get_cpu_features();
+	if (!sodium_runtime_has_ssse3()) {
+		printf("no SSSE3 on this cpu, only the scalar encoder was checked\n");
+		return ok ? 0 : 1;
+	}
+	ok = encode_all(simd) && ok;
+	if (memcmp(scalar, simd, sizeof(scalar))) {
+		printf("SSSE3 and scalar base64 differ\n");
+		ok = false;
+	}
+	printf("base64 lengths 0..%d: %s\n", max_len, ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "base64.h"
+
+#include <sodium/runtime.h>
+
+#include <tmmintrin.h>
+#include <cstdint>
+
+static const char alphabet[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static char*
+encode_scalar(char* dst, const uint8_t* src, std::size_t len, bool pad)
+{
+	for (; len >= 3; len -= 3, src += 3) {
+		const uint32_t v = src[0] << 16 | src[1] << 8 | src[2];
+		*dst++ = alphabet[v >> 18];
+		*dst++ = alphabet[v >> 12 & 63];
+		*dst++ = alphabet[v >> 6 & 63];
+		*dst++ = alphabet[v & 63];
+	}
+	if (len) {
+		const uint32_t v = src[0] << 16 | (len == 2 ? src[1] << 8 : 0);
+		*dst++ = alphabet[v >> 18];
+		*dst++ = alphabet[v >> 12 & 63];
+		if (len == 2) *dst++ = alphabet[v >> 6 & 63];
+		else if (pad) *dst++ = '=';
+		if (pad) *dst++ = '=';
+	}
+	return dst;
+}
+
+// 12 bytes at a time into 16 characters, after Wojciech Muła's SSSE3
+// encoder: spread every 3 bytes over a 32 bit lane, split the lane into four
+// 6 bit indices with two multiplications and map the indices to characters
+// by adding an offset picked with pshufb. The loads read 4 bytes past the
+// 12 they consume, so the last 4 input bytes are always left to the scalar
+// code.
+__attribute__((target("ssse3")))
+static const uint8_t*
+encode_ssse3(char*& dst, const uint8_t* src, std::size_t& len)
+{
+	const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i offsets = _mm_setr_epi8('A', 'a' - 26
+		, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52
+		, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 0, 0);
+	for (; len >= 16; len -= 12, src += 12, dst += 16) {
+		__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		in = _mm_shuffle_epi8(in, spread);
+		const __m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		const __m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		const __m128i indices = _mm_or_si128(hi, lo);
+		// 0 for A-Z, 1 for a-z, 2..11 for 0-9, 12 for '+' and 13 for '/'
+		__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		range = _mm_sub_epi8(range, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+		const __m128i out = _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+	}
+	return src;
+}
+
+ptrdiff_t
+base64_encode(char* dst, std::size_t dst_len, const void* src, std::size_t src_len, bool pad)
+{
+	const std::size_t need = pad ? (src_len + 2) / 3 * 4 : (src_len * 4 + 2) / 3;
+	if (need > dst_len) return -1;
+	char* d = dst;
+	auto s = static_cast<const uint8_t*>(src);
+	if (sodium_runtime_has_ssse3()) s = encode_ssse3(d, s, src_len);
+	return encode_scalar(d, s, src_len, pad) - dst;
+}
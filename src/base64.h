@@ -0,0 +1,13 @@
+#ifndef SLPM_BASE64_HEADER
+#define SLPM_BASE64_HEADER
+
+#include <cstddef>
+
+// Standard alphabet, padded with '=' unless pad is false as in OpenSSH
+// fingerprints. Returns the number of characters written, not terminated,
+// or -1 when they do not fit in dst_len. Runs on SSSE3 when the cpu has it,
+// which libsodium only knows once probe_cpu (see mpw.h) has run: until then,
+// and so with SLPM_BACKEND=portable, the scalar encoder is used.
+ptrdiff_t base64_encode(char* dst, std::size_t dst_len, const void* src, std::size_t src_len, bool pad = true);
+
+#endif // SLPM_BASE64_HEADER
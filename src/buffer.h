@@ -9,10 +9,12 @@
 #include <cstring>
 #include <arpa/inet.h>
 
-template <typename T, ptrdiff_t S>
+// Storage is std::array by default, see arena.h for the alternative. Only the
+// part that was written is wiped.
+template <typename T, ptrdiff_t S, typename Storage = std::array<T, S>>
 struct Buffer {
 	Buffer() = default;
-	~Buffer() { sodium_memzero(data(), capacity()); }
+	~Buffer() { sodium_memzero(data(), size()); }
 	Buffer(const Buffer&) = delete;
 	Buffer& operator=(const Buffer&) = delete;
 
@@ -52,6 +54,40 @@ struct Buffer {
 		return *this;
 	}
 
+	// Divides 16 bits at a time: without libgcc 32 bit targets have no
+	// 64 bit division.
+	Buffer&
+	append_decimal(uint64_t n)
+	{
+		uint32_t limbs[] = {
+			  static_cast<uint32_t>(n >> 48 & 0xffff)
+			, static_cast<uint32_t>(n >> 32 & 0xffff)
+			, static_cast<uint32_t>(n >> 16 & 0xffff)
+			, static_cast<uint32_t>(n & 0xffff)
+		};
+		char digits[20];
+		char* p = digits + sizeof(digits);
+		for (bool more = true; more; ) {
+			uint32_t r = 0;
+			more = false;
+			for (auto& l : limbs) {
+				const uint32_t cur = r << 16 | l;
+				l = cur / 10;
+				r = cur % 10;
+				more |= l;
+			}
+			*--p = '0' + r;
+		}
+		return append(p, digits + sizeof(digits) - p);
+	}
+
+	Buffer&
+	append_signed_decimal(int64_t n)
+	{
+		if (n < 0) *this += '-';
+		return append_decimal(n < 0 ? 0 - static_cast<uint64_t>(n) : n);
+	}
+
 	Buffer&
 	append_with_be32_length_prefix(const char* s)
 	{
@@ -65,12 +101,27 @@ struct Buffer {
 		return append(s, l);
 	}
 
+	// fill gets the unused capacity and returns how much of it it wrote
+	template <typename F>
+	Buffer&
+	append_from(F fill)
+	{
+		const ptrdiff_t n = fill(data() + size(), buf_.end() - last_);
+		if (n > 0 && n <= buf_.end() - last_) last_ += n;
+		return *this;
+	}
+
 	ssize_t write(int fd) const { return ::write(fd, data(), size()); }
 
-	void clear() { last_ = buf_.begin(); }
+	void
+	clear()
+	{
+		sodium_memzero(data(), size());
+		last_ = buf_.begin();
+	}
 
 private:
-	using Buf = std::array<T, S>;
+	using Buf = Storage;
 
 	Buf buf_;
 	typename Buf::iterator last_ = buf_.begin();
@@ -0,0 +1,43 @@
+// The wrappers mylibc-lowlevel.c provides beyond libc, for the hosted helpers
+// built from slpm's sources (agent-bench).
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+long
+futex(int* uaddr, int op, int val, const void* timeout)
+{
+	return syscall(SYS_futex, uaddr, op, val, timeout);
+}
+
+int
+rt_sigprocmask(int how, const void* set, void* oldset, size_t sigsetsize)
+{
+	return syscall(SYS_rt_sigprocmask, how, set, oldset, sigsetsize);
+}
+
+struct start {
+	void (*fn)(void*);
+	void* arg;
+};
+
+static int
+trampoline(void* p)
+{
+	struct start* s = p;
+	s->fn(s->arg);
+	return 0;
+}
+
+int
+clone_thread(unsigned long flags, void* stack_top, void (*fn)(void*), void* arg)
+{
+	struct start* s = (struct start*)((uintptr_t)stack_top - 16);
+	s->fn = fn;
+	s->arg = arg;
+	return clone(trampoline, s - 1, flags, s);
+}
@@ -0,0 +1,118 @@
+#include "kdf.h"
+
+#include "buffer.h"
+#include "utils.h"
+
+#include <cstring>
+#include <algorithm>
+
+#define COUNT(x) (sizeof(x) / sizeof(x[0]))
+
+static const KdfProfile profiles[] = {
+	  { 32768, 8, 2 }
+	, { 16384, 8, 1 }
+	, { 32768, 8, 1 }
+	, { 65536, 8, 2 }
+	, { 131072, 8, 2 }
+	, { 262144, 8, 2 }
+};
+
+const KdfProfile*
+kdf_profile(unsigned id)
+{
+	return id < COUNT(profiles) ? &profiles[id] : nullptr;
+}
+
+int
+kdf_derive(const KdfProfile& kp, Romix romix, const char* pw, const uint8_t* salt, size_t saltlen, uint8_t* key, size_t keysize)
+{
+	return scrypt(
+		  romix
+		, reinterpret_cast<const uint8_t*>(pw)
+		, strlen(pw)
+		, salt
+		, saltlen
+		, static_cast<uint32_t>(kp.N)
+		, kp.r
+		, kp.p
+		, key
+		, keysize
+	);
+}
+
+// in multiples of N = 1024, r = 1, p = 1 to stay clear of 64 bit divisions
+static unsigned long
+cost(const KdfProfile& kp)
+{
+	return static_cast<unsigned long>(kp.N >> 10) * kp.r * kp.p;
+}
+
+// Times the cheapest profile with as many lanes as kp. Depending on the ROMix
+// mode lanes run concurrently, so the time does not grow linearly with p.
+static long
+us_per_cost(const KdfProfile& kp, Romix romix)
+{
+	// 0 until measured
+	static long measured[COUNT(profiles)];
+	unsigned base = COUNT(profiles);
+	for (unsigned i = 0; i != COUNT(profiles); ++i) {
+		if (profiles[i].p != kp.p) continue;
+		if (base == COUNT(profiles) || cost(profiles[i]) < cost(profiles[base])) base = i;
+	}
+	if (!measured[base]) {
+		static const char salt[] = "slpm calibration";
+		uint8_t key[64];
+		const auto start = monotonic_us();
+		if (kdf_derive(profiles[base], romix, "calibration", reinterpret_cast<const uint8_t*>(salt), sizeof(salt) - 1, key, sizeof(key))) {
+			writes(STDERR_FILENO, "scrypt fail\n");
+			return -1;
+		}
+		measured[base] = std::max(1ul, (monotonic_us() - start) / cost(profiles[base]));
+	}
+	return measured[base];
+}
+
+int
+kdf_calibrate(unsigned target_ms, Romix romix)
+{
+	int suggested = -1;
+	for (unsigned i = 0; i != COUNT(profiles); ++i) {
+		const auto& kp = profiles[i];
+		const long us = us_per_cost(kp, romix);
+		if (us < 0) return -1;
+		const unsigned long ms = us * cost(kp) / 1000;
+		if (ms <= target_ms && (suggested == -1 || cost(kp) > cost(profiles[suggested]))) {
+			suggested = i;
+		}
+		Buffer<uint8_t, 128> buf;
+		buf += "profile ";
+		buf.append_decimal(i);
+		buf += ": N=";
+		buf.append_decimal(kp.N);
+		buf += " r=";
+		buf.append_decimal(kp.r);
+		buf += " p=";
+		buf.append_decimal(kp.p);
+		buf += ", ";
+		buf.append_decimal((128 * kp.r * kp.N) >> 20);
+		buf += " MiB, ~";
+		buf.append_decimal(ms);
+		buf += " ms\n";
+		buf.write(STDOUT_FILENO);
+	}
+
+	Buffer<uint8_t, 128> buf;
+	if (suggested == -1) {
+		buf += "No profile fits in ";
+		buf.append_decimal(target_ms);
+		buf += " ms\n";
+	} else {
+		buf += "Suggested for ";
+		buf.append_decimal(target_ms);
+		buf += " ms: SLPM_KDF_PROFILE=";
+		buf.append_decimal(suggested);
+		buf += '\n';
+	}
+	buf.write(STDOUT_FILENO);
+	return 0;
+}
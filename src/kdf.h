@@ -0,0 +1,48 @@
+#ifndef SLPM_KDF_HEADER
+#define SLPM_KDF_HEADER
+
+#include "scrypt.h"
+
+#include <cstddef>
+#include <cstdint>
+
+struct KdfProfile {
+	uint64_t N;
+	uint32_t r;
+	uint32_t p;
+};
+
+// Profile 0 is the MasterPassword compatible one. Every other profile has its
+// identifier appended to the salt, so picking a different profile never
+// silently yields the keys of another one.
+const KdfProfile* kdf_profile(unsigned id);
+
+int kdf_derive(const KdfProfile&, Romix, const char* pw, const uint8_t* salt, size_t saltlen, uint8_t* key, size_t keysize);
+
+// Times the cheapest profile of every lane count with the given ROMix mode
+// and prints the estimated unlock time of every profile together with the
+// strongest one fitting in target_ms.
+int kdf_calibrate(unsigned target_ms, Romix);
+
+// KDF policy of the pipeline (see pipeline.h).
+struct ScryptKdf {
+	Romix romix = Romix::reference;
+
+	bool
+	select(unsigned profile)
+	{
+		profile_ = kdf_profile(profile);
+		return profile_;
+	}
+
+	int
+	derive(const char* pw, const uint8_t* salt, size_t saltlen, uint8_t* key, size_t keysize) const
+	{
+		return kdf_derive(*profile_, romix, pw, salt, saltlen, key, keysize);
+	}
+
+private:
+	const KdfProfile* profile_ = nullptr;
+};
+
+#endif // SLPM_KDF_HEADER
@@ -0,0 +1,74 @@
+#include "keyring.h"
+
+#include "buffer.h"
+
+#include <sodium/crypto_hash_sha256.h>
+
+#include <linux/keyctl.h>
+
+extern "C" {
+int add_key(const char* type, const char* description, const void* payload, size_t plen, int32_t ringid);
+long keyctl(int cmd, unsigned long arg2, unsigned long arg3, unsigned long arg4, unsigned long arg5);
+}
+
+using Description = Buffer<char, 80>;
+
+static void
+describe(Description& desc, const uint8_t* salt, size_t saltlen)
+{
+	static const char hex[] = "0123456789abcdef";
+	uint8_t h[crypto_hash_sha256_BYTES];
+	crypto_hash_sha256(h, salt, saltlen);
+	desc += "slpm:";
+	for (const auto b : h) {
+		desc += hex[b >> 4];
+		desc += hex[b & 15];
+	}
+	desc += '\0';
+}
+
+// Without a session keyring (no pam_keyinit) add_key would create an anonymous
+// one that dies with the process, so the ring is resolved without creating
+// it, which falls back to the user session keyring.
+static long
+session_keyring()
+{
+	return keyctl(KEYCTL_GET_KEYRING_ID, KEY_SPEC_SESSION_KEYRING, 0, 0, 0);
+}
+
+bool
+keyring_load(const uint8_t* salt, size_t saltlen, uint8_t* key, size_t keysize)
+{
+	Description desc;
+	describe(desc, salt, saltlen);
+	const long id = keyctl(
+		  KEYCTL_SEARCH
+		, KEY_SPEC_SESSION_KEYRING
+		, reinterpret_cast<unsigned long>("user")
+		, reinterpret_cast<unsigned long>(desc.data())
+		, 0
+	);
+	if (id < 0) return false;
+	const long rd = keyctl(KEYCTL_READ, id, reinterpret_cast<unsigned long>(key), keysize, 0);
+	if (rd != static_cast<long>(keysize)) {
+		sodium_memzero(key, keysize);
+		return false;
+	}
+	return true;
+}
+
+bool
+keyring_store(const uint8_t* salt, size_t saltlen, const uint8_t* key, size_t keysize, unsigned timeout)
+{
+	Description desc;
+	describe(desc, salt, saltlen);
+	const long ring = session_keyring();
+	if (ring < 0) return false;
+	const int id = add_key("user", desc.data(), key, keysize, ring);
+	if (id < 0) return false;
+	if (keyctl(KEYCTL_SET_TIMEOUT, id, timeout, 0, 0) < 0) {
+		keyctl(KEYCTL_INVALIDATE, id, 0, 0, 0);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,13 @@
+#ifndef SLPM_KEYRING_HEADER
+#define SLPM_KEYRING_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+// The derived key is cached in the session keyring under a description made
+// of a hash of the salt, so it never touches the disk and identities with
+// different full names do not share an entry.
+bool keyring_load(const uint8_t* salt, size_t saltlen, uint8_t* key, size_t keysize);
+bool keyring_store(const uint8_t* salt, size_t saltlen, const uint8_t* key, size_t keysize, unsigned timeout);
+
+#endif // SLPM_KEYRING_HEADER
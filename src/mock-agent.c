@@ -0,0 +1,217 @@
+// A stand-in for ssh-agent which speaks just enough of the protocol (adding,
+// removing and listing identities) to exercise SshAgent without a real agent.
+// It is a hosted helper for bench-agent.sh and is not part of slpm.
+//
+// Usage: mock-agent SOCKET [-l LATENCY_US] [-f FRAGMENT_BYTES] [-e FAIL_EVERY]
+//
+// -l delays every response, -f writes responses in pieces of the given size
+// and -e answers every n-th request with a failure without acting on it.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define SSH_AGENT_FAILURE 5
+#define SSH_AGENT_SUCCESS 6
+#define SSH2_AGENTC_REQUEST_IDENTITIES 11
+#define SSH2_AGENT_IDENTITIES_ANSWER 12
+#define SSH2_AGENTC_ADD_IDENTITY 17
+#define SSH2_AGENTC_REMOVE_IDENTITY 18
+#define SSH2_AGENTC_ADD_ID_CONSTRAINED 25
+
+#define MAX_KEYS 1024
+#define MAX_MSG 8192
+
+static struct {
+	uint8_t blob[128];
+	uint32_t bloblen;
+	char comment[256];
+	uint32_t commentlen;
+} keys[MAX_KEYS];
+static int nkeys;
+
+static unsigned latency_us;
+static unsigned fragment;
+static unsigned fail_every;
+static unsigned long requests;
+
+static int
+read_full(int fd, uint8_t* p, size_t n)
+{
+	while (n) {
+		const ssize_t rd = read(fd, p, n);
+		if (rd <= 0) return -1;
+		p += rd;
+		n -= rd;
+	}
+	return 0;
+}
+
+static int
+write_full(int fd, const uint8_t* p, size_t n)
+{
+	while (n) {
+		const size_t chunk = fragment && fragment < n ? fragment : n;
+		const ssize_t wr = write(fd, p, chunk);
+		if (wr <= 0) return -1;
+		p += wr;
+		n -= wr;
+		if (fragment && n) usleep(50);
+	}
+	return 0;
+}
+
+// Parses a length-prefixed string at *p, advancing *p past it.
+static const uint8_t*
+string(const uint8_t** p, const uint8_t* end, uint32_t* len)
+{
+	if (end - *p < 4) return NULL;
+	memcpy(len, *p, 4);
+	*len = ntohl(*len);
+	if ((uint32_t)(end - *p - 4) < *len) return NULL;
+	const uint8_t* s = *p + 4;
+	*p = s + *len;
+	return s;
+}
+
+static int
+find(const uint8_t* blob, uint32_t len)
+{
+	for (int i = 0; i != nkeys; ++i) {
+		if (keys[i].bloblen == len && !memcmp(keys[i].blob, blob, len)) return i;
+	}
+	return -1;
+}
+
+static int
+add(const uint8_t* p, const uint8_t* end)
+{
+	const uint8_t* blob = p;
+	uint32_t len;
+	if (!string(&p, end, &len) || !string(&p, end, &len)) return SSH_AGENT_FAILURE;
+	const uint32_t bloblen = p - blob;
+	if (!string(&p, end, &len)) return SSH_AGENT_FAILURE; // secret key
+	const uint8_t* comment = string(&p, end, &len);
+	if (!comment || bloblen > sizeof(keys[0].blob)) return SSH_AGENT_FAILURE;
+	int i = find(blob, bloblen);
+	if (i == -1) {
+		if (nkeys == MAX_KEYS) return SSH_AGENT_FAILURE;
+		i = nkeys++;
+	}
+	memcpy(keys[i].blob, blob, bloblen);
+	keys[i].bloblen = bloblen;
+	keys[i].commentlen = len < sizeof(keys[i].comment) ? len : sizeof(keys[i].comment);
+	memcpy(keys[i].comment, comment, keys[i].commentlen);
+	return SSH_AGENT_SUCCESS;
+}
+
+static int
+remove_identity(const uint8_t* p, const uint8_t* end)
+{
+	uint32_t len;
+	const uint8_t* blob = string(&p, end, &len);
+	const int i = blob ? find(blob, len) : -1;
+	if (i == -1) return SSH_AGENT_FAILURE;
+	keys[i] = keys[--nkeys];
+	return SSH_AGENT_SUCCESS;
+}
+
+static size_t
+put32(uint8_t* p, uint32_t v)
+{
+	v = htonl(v);
+	memcpy(p, &v, 4);
+	return 4;
+}
+
+static size_t
+list(uint8_t* out)
+{
+	size_t n = 4;
+	out[n++] = SSH2_AGENT_IDENTITIES_ANSWER;
+	n += put32(out + n, nkeys);
+	for (int i = 0; i != nkeys; ++i) {
+		n += put32(out + n, keys[i].bloblen);
+		memcpy(out + n, keys[i].blob, keys[i].bloblen);
+		n += keys[i].bloblen;
+		n += put32(out + n, keys[i].commentlen);
+		memcpy(out + n, keys[i].comment, keys[i].commentlen);
+		n += keys[i].commentlen;
+	}
+	return n;
+}
+
+static void
+serve(int fd)
+{
+	static uint8_t msg[MAX_MSG];
+	static uint8_t out[9 + MAX_KEYS * (8 + sizeof(keys[0].blob) + sizeof(keys[0].comment))];
+	while (1) {
+		uint32_t len;
+		if (read_full(fd, msg, 4)) return;
+		memcpy(&len, msg, 4);
+		len = ntohl(len);
+		if (!len || len > sizeof(msg)) return;
+		if (read_full(fd, msg, len)) return;
+
+		size_t n = 4;
+		if (fail_every && ++requests % fail_every == 0) {
+			out[n++] = SSH_AGENT_FAILURE;
+		} else switch (msg[0]) {
+		case SSH2_AGENTC_ADD_IDENTITY:
+		case SSH2_AGENTC_ADD_ID_CONSTRAINED:
+			out[n++] = add(msg + 1, msg + len);
+			break;
+		case SSH2_AGENTC_REMOVE_IDENTITY:
+			out[n++] = remove_identity(msg + 1, msg + len);
+			break;
+		case SSH2_AGENTC_REQUEST_IDENTITIES:
+			n = list(out);
+			break;
+		default:
+			out[n++] = SSH_AGENT_FAILURE;
+		}
+		put32(out, n - 4);
+		if (latency_us) usleep(latency_us);
+		if (write_full(fd, out, n)) return;
+	}
+}
+
+int
+main(int argc, char* argv[])
+{
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s SOCKET [-l LATENCY_US] [-f FRAGMENT_BYTES] [-e FAIL_EVERY]\n", argv[0]);
+		return 1;
+	}
+	for (int i = 2; i + 1 < argc; i += 2) {
+		const unsigned v = strtoul(argv[i + 1], NULL, 10);
+		if (!strcmp(argv[i], "-l")) latency_us = v;
+		else if (!strcmp(argv[i], "-f")) fragment = v;
+		else if (!strcmp(argv[i], "-e")) fail_every = v;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	struct sockaddr_un sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, argv[1], sizeof(sa.sun_path) - 1);
+	const int s = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(argv[1]);
+	if (s == -1 || bind(s, (struct sockaddr*)&sa, sizeof(sa)) || listen(s, 8)) {
+		perror("mock-agent");
+		return 1;
+	}
+	while (1) {
+		const int fd = accept(s, NULL, NULL);
+		if (fd == -1) continue;
+		serve(fd);
+		close(fd);
+	}
+}
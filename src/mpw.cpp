@@ -1,11 +1,98 @@
 #include "mpw.h"
 
-#include "buffer.h"
+#include "arena.h"
+#include "sink.h"
+
+#include <sodium/crypto_generichash_blake2b.h>
 
 #include <cassert>
 
 #define COUNT(x) (sizeof(x) / sizeof(x[0]))
 
+const char mpw_iv[] = "com.lyndir.masterpassword";
+
+static int
+hmacsha256(
+	  uint8_t *out
+	, const uint8_t *in, size_t inlen
+	, const uint8_t *k, size_t klen
+)
+{
+	struct crypto_auth_hmacsha256_state state;
+	if (crypto_auth_hmacsha256_init(&state, k, klen)) return -1;
+	if (crypto_auth_hmacsha256_update(&state, in, inlen)) return -2;
+	if (crypto_auth_hmacsha256_final(&state, out)) return -3;
+	return 0;
+}
+
+extern "C" {
+int _sodium_runtime_get_cpu_features(void);
+int _crypto_generichash_blake2b_pick_best_implementation(void);
+}
+
+const SeedAlgorithm*
+seed_algorithm(const char* name)
+{
+	static const SeedAlgorithm hmacsha256 = SeedAlgorithm::hmacsha256;
+	static const SeedAlgorithm blake2b = SeedAlgorithm::blake2b;
+	if (!strcmp(name, "hmac-sha256")) return &hmacsha256;
+	if (!strcmp(name, "blake2b")) return &blake2b;
+	return 0;
+}
+
+void
+probe_cpu()
+{
+	_sodium_runtime_get_cpu_features();
+}
+
+// Until this is called blake2b runs the portable compression function, after
+// it the AVX2, SSE4.1 or SSSE3 one, whichever the cpu supports.
+void
+seed_init()
+{
+	probe_cpu();
+	_crypto_generichash_blake2b_pick_best_implementation();
+}
+
+using Message = ScratchBuffer<uint8_t, 4096>;
+
+static void
+site_message(Message& buf, const char* site, int counter)
+{
+	buf += mpw_iv;
+	buf.append_with_be32_length_prefix(site);
+	buf.append_network_long(counter);
+}
+
+int
+hmacsha256_seed(Seed& seed, const uint8_t* key, size_t keysize, const char* site, int counter)
+{
+	Message buf;
+	site_message(buf, site, counter);
+	return hmacsha256(seed.data(), buf.data(), buf.size(), key, keysize);
+}
+
+int
+blake2b_seed(Seed& seed, const uint8_t* key, size_t keysize, const char* site, int counter)
+{
+	Message buf;
+	site_message(buf, site, counter);
+	return crypto_generichash_blake2b(seed.data(), seed.size(), buf.data(), buf.size(), key, keysize);
+}
+
+int
+site_seed(Seed& seed, SeedAlgorithm alg, const uint8_t* key, size_t keysize, const char* site, int counter)
+{
+	switch (alg) {
+	case SeedAlgorithm::blake2b:
+		return blake2b_seed(seed, key, keysize, site, counter);
+	case SeedAlgorithm::hmacsha256:
+		break;
+	}
+	return hmacsha256_seed(seed, key, keysize, site, counter);
+}
+
 static const char*
 lookup_pass_chars(char templat)
 {
@@ -88,12 +175,10 @@ static const struct {
 };
 
 void
-output_site_generic(const Seed& seed)
+output_site_generic(Sink& sink, const Seed& seed, const char* site, int counter)
 {
-	Buffer<uint8_t, 4096> buf;
 	for (unsigned i = 0; i != COUNT(templates); ++i) {
-		buf += templates[i].name;
-		buf += ": ";
+		ScratchBuffer<char, 64> buf;
 		const char* templat = templates[i].templat[seed[0] % templates[i].count];
 		for (unsigned j = 0; templat[j]; ++j) {
 			const char* pass_chars = lookup_pass_chars(templat[j]);
@@ -101,8 +186,41 @@ output_site_generic(const Seed& seed)
 			assert(seed.size() > 1 + j);
 			buf += pass_chars[seed[1 + j] % len];
 		}
-		buf += '\n';
+		sink.password(site, counter, templates[i].name, buf.data(), buf.size());
 	}
+}
 
-	buf.write(STDOUT_FILENO);
+unsigned
+templates_of_length(size_t len)
+{
+	unsigned mask = 0;
+	for (unsigned i = 0; i != COUNT(templates); ++i) {
+		for (unsigned j = 0; j != templates[i].count; ++j) {
+			if (strlen(templates[i].templat[j]) == len) mask |= 1u << i;
+		}
+	}
+	return mask;
+}
+
+unsigned
+match_site_generic(const Seed& seed, const char* password, unsigned mask)
+{
+	unsigned result = 0;
+	for (unsigned i = 0; i != COUNT(templates); ++i) {
+		if (!(mask & (1u << i))) continue;
+		const char* templat = templates[i].templat[seed[0] % templates[i].count];
+		unsigned j = 0;
+		for (; templat[j] && password[j]; ++j) {
+			const char* pass_chars = lookup_pass_chars(templat[j]);
+			if (pass_chars[seed[1 + j] % strlen(pass_chars)] != password[j]) break;
+		}
+		if (!templat[j] && !password[j]) result |= 1u << i;
+	}
+	return result;
+}
+
+const char*
+template_name(unsigned i)
+{
+	return i < COUNT(templates) ? templates[i].name : 0;
 }
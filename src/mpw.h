@@ -4,9 +4,88 @@
 #include <sodium/crypto_auth_hmacsha256.h>
 
 #include <array>
+#include <cstring>
+
+struct Sink;
 
 using Seed = std::array<uint8_t, crypto_auth_hmacsha256_BYTES>;
 
-void output_site_generic(const Seed&);
+extern const char mpw_iv[];
+
+enum class SeedAlgorithm {
+	  hmacsha256 // MasterPassword compatible
+	, blake2b
+};
+
+const SeedAlgorithm* seed_algorithm(const char* name);
+void probe_cpu();
+void seed_init();
+int hmacsha256_seed(Seed&, const uint8_t* key, size_t keysize, const char* site, int counter);
+int blake2b_seed(Seed&, const uint8_t* key, size_t keysize, const char* site, int counter);
+int site_seed(Seed&, SeedAlgorithm, const uint8_t* key, size_t keysize, const char* site, int counter);
+void output_site_generic(Sink&, const Seed&, const char* site, int counter);
+
+// Seed MAC policies of the pipeline (see pipeline.h) and search_sites. The
+// fixed ones keep the other algorithm out of the binary, RuntimeMac picks
+// one per session.
+struct HmacSha256Mac {
+	static constexpr const char* names = "hmac-sha256";
+	static void init() { probe_cpu(); }
+	bool select(const char* name) { return !strcmp(name, names); }
+	const char* default_name(unsigned) const { return names; }
+	SeedAlgorithm algorithm() const { return SeedAlgorithm::hmacsha256; }
+
+	int
+	seed(Seed& seed, const uint8_t* key, size_t keysize, const char* site, int counter) const
+	{
+		return hmacsha256_seed(seed, key, keysize, site, counter);
+	}
+};
+
+struct Blake2bMac {
+	static constexpr const char* names = "blake2b";
+	static void init() { seed_init(); }
+	bool select(const char* name) { return !strcmp(name, names); }
+	const char* default_name(unsigned) const { return names; }
+	SeedAlgorithm algorithm() const { return SeedAlgorithm::blake2b; }
+
+	int
+	seed(Seed& seed, const uint8_t* key, size_t keysize, const char* site, int counter) const
+	{
+		return blake2b_seed(seed, key, keysize, site, counter);
+	}
+};
+
+struct RuntimeMac {
+	static constexpr const char* names = "hmac-sha256 or blake2b";
+	static void init() { seed_init(); }
+
+	bool
+	select(const char* name)
+	{
+		const SeedAlgorithm* alg = seed_algorithm(name);
+		if (alg) alg_ = *alg;
+		return alg;
+	}
+
+	// profile 0 stays MasterPassword compatible, newer ones default to blake2b
+	const char* default_name(unsigned profile) const { return profile ? "blake2b" : "hmac-sha256"; }
+	SeedAlgorithm algorithm() const { return alg_; }
+
+	int
+	seed(Seed& seed, const uint8_t* key, size_t keysize, const char* site, int counter) const
+	{
+		return site_seed(seed, alg_, key, keysize, site, counter);
+	}
+
+private:
+	SeedAlgorithm alg_ = SeedAlgorithm::hmacsha256;
+};
+
+// Bit i of a template mask stands for the i-th template class (Maximum
+// Security Password, Long Password, ...).
+unsigned templates_of_length(size_t len);
+unsigned match_site_generic(const Seed&, const char* password, unsigned mask);
+const char* template_name(unsigned i);
 
 #endif // SLPM_MPW_HEADER
@@ -75,7 +75,7 @@ _exit(int status)
 	__asm__ volatile(
 		"int $0x80"
 		:
-		: "a" (1), "b" (status)
+		: "a" (0xfc), "b" (status) // exit_group, so threads go too
 	);
 	__builtin_unreachable();
 }
@@ -174,6 +174,221 @@ access(const char* pathname, int mode)
 	return result;
 }
 
+pid_t
+fork(void)
+{
+	pid_t result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (2)
+		: "cc", "ebx", "ecx", "edx", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+pid_t
+waitpid(pid_t pid, int* status, int options)
+{
+	pid_t result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (7), "b" (pid), "c" (status), "d" (options)
+		: "cc", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+int
+sched_getaffinity(pid_t pid, size_t cpusetsize, void* mask)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0xf2), "b" (pid), "c" (cpusetsize), "d" (mask)
+		: "cc", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+int
+clock_gettime(int clk_id, void* tp)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x109), "b" (clk_id), "c" (tp)
+		: "cc", "edx", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+struct iovec;
+
+ssize_t
+writev(int fd, const struct iovec* iov, int iovcnt)
+{
+	ssize_t result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x92), "b" (fd), "c" (iov), "d" (iovcnt)
+		: "cc", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+int
+add_key(const char* type, const char* description, const void* payload, size_t plen, int32_t ringid)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x11e), "b" (type), "c" (description), "d" (payload), "S" (plen), "D" (ringid)
+		: "cc", "memory"
+	);
+	return result;
+}
+
+long
+keyctl(int cmd, unsigned long arg2, unsigned long arg3, unsigned long arg4, unsigned long arg5)
+{
+	long result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x120), "b" (cmd), "c" (arg2), "d" (arg3), "S" (arg4), "D" (arg5)
+		: "cc", "memory"
+	);
+	return result;
+}
+
+int
+mlock(const void* addr, size_t len)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x96), "b" (addr), "c" (len)
+		: "cc", "edx", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+int
+madvise(void* addr, size_t length, int advice)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0xdb), "b" (addr), "c" (length), "d" (advice)
+		: "cc", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+int
+mprotect(void* addr, size_t len, int prot)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x7d), "b" (addr), "c" (len), "d" (prot)
+		: "cc", "edi", "esi", "memory"
+	);
+	return result;
+}
+
+int
+rt_sigprocmask(int how, const void* set, void* oldset, size_t sigsetsize)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0xaf), "b" (how), "c" (set), "d" (oldset), "S" (sigsetsize)
+		: "cc", "edi", "memory"
+	);
+	return result;
+}
+
+long
+futex(int* uaddr, int op, int val, const void* timeout)
+{
+	long result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0xf0), "b" (uaddr), "c" (op), "d" (val), "S" (timeout)
+		: "cc", "edi", "memory"
+	);
+	return result;
+}
+
+// Runs fn(arg) in a new thread on the stack ending at stack_top, the thread
+// exits when fn returns. fn and arg are handed over on the new stack, with
+// the stack 16 byte aligned at the call.
+int
+clone_thread(unsigned long flags, void* stack_top, void (*fn)(void*), void* arg)
+{
+	void** sp = (void**)((uintptr_t)stack_top - 16);
+	sp[0] = arg;
+	*--sp = (void*)fn;
+	int result;
+	__asm__ volatile(
+		"int $0x80\n\t"
+		"testl %%eax, %%eax\n\t"
+		"jnz 1f\n\t"
+		"popl %%eax\n\t"
+		"call *%%eax\n\t"
+		"movl $1, %%eax\n\t" // exit, of this thread only
+		"xorl %%ebx, %%ebx\n\t"
+		"int $0x80\n"
+		"1:"
+		: "=a" (result)
+		: "a" (0x78), "b" (flags), "c" (sp), "d" (0), "S" (0), "D" (0)
+		: "cc", "memory"
+	);
+	return result;
+}
+
+struct perf_event_attr;
+
+int
+perf_event_open(struct perf_event_attr* attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x150), "b" (attr), "c" (pid), "d" (cpu), "S" (group_fd), "D" (flags)
+		: "cc", "memory"
+	);
+	return result;
+}
+
+struct rusage;
+
+int
+getrusage(int who, struct rusage* usage)
+{
+	int result;
+	__asm__ volatile(
+		"int $0x80"
+		: "=a" (result)
+		: "a" (0x4d), "b" (who), "c" (usage)
+		: "cc", "edx", "edi", "esi", "memory"
+	);
+	return result;
+}
+
 #endif // __i386__
 
 void*
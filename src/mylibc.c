@@ -1,6 +1,10 @@
 #include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <unistd.h>
 
 void*
 memchr(const void* s, int c, size_t n)
@@ -87,6 +91,51 @@ atoi(const char* nptr)
 	return result;
 }
 
+long
+strtol(const char* nptr, char** endptr, int base)
+{
+	const char* p = nptr;
+	while (*p == ' ' || (*p >= '\t' && *p <= '\r')) ++p;
+	const int negative = *p == '-';
+	if (*p == '-' || *p == '+') ++p;
+	if ((base == 0 || base == 16) && p[0] == '0' && (p[1] | 0x20) == 'x') {
+		p += 2;
+		base = 16;
+	} else if (base == 0) {
+		base = *p == '0' ? 8 : 10;
+	}
+	// accumulated negatively, LONG_MIN has no positive counterpart
+	const long limit = LONG_MIN / base;
+	long result = 0;
+	int overflow = 0;
+	const char* digits = p;
+	for (;; ++p) {
+		int d;
+		if (*p >= '0' && *p <= '9') d = *p - '0';
+		else if ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'z') d = (*p | 0x20) - 'a' + 10;
+		else break;
+		if (d >= base) break;
+		if (result < limit || result * base < LONG_MIN + d) overflow = 1;
+		else result = result * base - d;
+	}
+	if (p == digits) {
+		if (endptr) *endptr = (char*)nptr;
+		return 0;
+	}
+	if (endptr) *endptr = (char*)p;
+	if (overflow || (!negative && result == LONG_MIN)) {
+		errno = ERANGE;
+		return negative ? LONG_MIN : LONG_MAX;
+	}
+	return negative ? result : -result;
+}
+
+void
+abort(void)
+{
+	_exit(127);
+}
+
 int *
 __errno_location(void)
 {
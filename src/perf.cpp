@@ -0,0 +1,210 @@
+#include "perf.h"
+
+#include "arena.h"
+#include "buffer.h"
+#include "utils.h"
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" int perf_event_open(struct perf_event_attr* attr, pid_t pid, int cpu, int group_fd, unsigned long flags);
+
+struct Counter {
+	const char* name;
+	uint32_t type;
+	uint64_t config;
+};
+
+static const Counter counters[] = {
+	  { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES }
+	, { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS }
+	, { "llc-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+		| PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 }
+	, { "dtlb-misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+		| PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16 }
+	, { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS }
+};
+static const int ncounters = sizeof(counters) / sizeof(counters[0]);
+
+static const char* stage_names[] = { "startup", "kdf", "seed", "keygen" };
+static const int nstages = sizeof(stage_names) / sizeof(stage_names[0]);
+
+// layout of a read of one counter; inherited counters cannot be read as a
+// group, so each has an fd of its own
+struct CounterRead {
+	uint64_t value;
+	uint64_t time_enabled;
+	uint64_t time_running;
+};
+
+struct Sample {
+	unsigned long us;
+	uint64_t values[ncounters];
+};
+
+struct Totals {
+	unsigned long calls;
+	uint64_t us;
+	uint64_t values[ncounters];
+};
+
+static bool enabled = false;
+static bool any_counter = false;
+// -1 when the counter could not be opened
+static int fds[ncounters];
+static bool multiplexed = false;
+static unsigned long faults_before_main = 0;
+static Sample starts[nstages];
+static bool running[nstages];
+static Totals totals[nstages];
+
+static unsigned long
+page_faults(int who)
+{
+	struct rusage ru;
+	memset(&ru, 0, sizeof(ru));
+	if (getrusage(who, &ru)) return 0;
+	return ru.ru_minflt + ru.ru_majflt;
+}
+
+static int
+open_counter(const Counter& c)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = c.type;
+	attr.config = c.config;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	// pool threads and the processes deriving the keys of further identities
+	// are counted too, a read sums them up
+	attr.inherit = 1;
+	attr.exclude_hv = 1;
+	int fd = perf_event_open(&attr, 0, -1, -1, 0);
+	if (fd < 0) {
+		// perf_event_paranoid 2 only allows counting user space
+		attr.exclude_kernel = 1;
+		fd = perf_event_open(&attr, 0, -1, -1, 0);
+	}
+	return fd;
+}
+
+void
+perf_init()
+{
+	if (!atoi(getenv_or("SLPM_PERF", "0"))) return;
+	enabled = true;
+	// whatever happened before main, including unpacking the executable
+	faults_before_main = page_faults(RUSAGE_SELF);
+	for (int i = 0; i != ncounters; ++i) {
+		fds[i] = open_counter(counters[i]);
+		if (fds[i] >= 0) any_counter = true;
+		else fds[i] = -1;
+	}
+	perf_begin(Stage::startup);
+}
+
+static void
+sample(Sample& s)
+{
+	s.us = monotonic_us();
+	for (int i = 0; i != ncounters; ++i) {
+		CounterRead r;
+		memset(&r, 0, sizeof(r));
+		if (fds[i] != -1 && read(fds[i], &r, sizeof(r)) > 0 && r.time_running < r.time_enabled) {
+			multiplexed = true;
+		}
+		s.values[i] = r.value;
+	}
+}
+
+void
+perf_begin(Stage stage)
+{
+	if (!enabled) return;
+	running[static_cast<int>(stage)] = true;
+	sample(starts[static_cast<int>(stage)]);
+}
+
+void
+perf_end(Stage stage)
+{
+	if (!enabled || !running[static_cast<int>(stage)]) return;
+	running[static_cast<int>(stage)] = false;
+	Sample now;
+	sample(now);
+	const auto& start = starts[static_cast<int>(stage)];
+	auto& t = totals[static_cast<int>(stage)];
+	++t.calls;
+	t.us += now.us - start.us;
+	for (int i = 0; i != ncounters; ++i) t.values[i] += now.values[i] - start.values[i];
+}
+
+using Line = Buffer<char, 256>;
+
+static void
+column(Line& line, const char* s, ptrdiff_t len)
+{
+	for (ptrdiff_t i = len; i < 13; ++i) line += ' ';
+	line += ' ';
+	line.append(s, len);
+}
+
+static void
+column(Line& line, uint64_t n)
+{
+	Buffer<char, 24> digits;
+	digits.append_decimal(n);
+	column(line, digits.data(), digits.size());
+}
+
+void
+perf_report(int fd)
+{
+	if (!enabled) return;
+	// an early exit leaves the stage it happened in open
+	for (int s = 0; s != nstages; ++s) perf_end(static_cast<Stage>(s));
+	{
+		Line line;
+		line += "stage    ";
+		column(line, "calls", 5);
+		column(line, "wall-us", 7);
+		for (const auto& c : counters) column(line, c.name, strlen(c.name));
+		line += '\n';
+		line.write(fd);
+	}
+	for (int s = 0; s != nstages; ++s) {
+		const auto& t = totals[s];
+		Line line;
+		line += stage_names[s];
+		for (auto i = strlen(stage_names[s]); i < 9; ++i) line += ' ';
+		column(line, t.calls);
+		column(line, t.us);
+		for (int i = 0; i != ncounters; ++i) {
+			if (fds[i] == -1) column(line, "-", 1);
+			else column(line, t.values[i]);
+		}
+		line += '\n';
+		line.write(fd);
+	}
+	Line line;
+	line += "page faults before main: ";
+	line.append_decimal(faults_before_main);
+	line += ", in total: ";
+	line.append_decimal(page_faults(RUSAGE_SELF) + page_faults(RUSAGE_CHILDREN));
+	line += '\n';
+	line += "scratch arena high-water: ";
+	line.append_decimal(arena_high_water());
+	line += " of ";
+	line.append_decimal(arena_size());
+	line += " bytes\n";
+	line.write(fd);
+	if (!any_counter) {
+		writes(fd, "No performance counters available, see /proc/sys/kernel/perf_event_paranoid\n");
+	} else if (multiplexed) {
+		writes(fd, "Counters were not scheduled all the time, their values are lower bounds\n");
+	}
+}
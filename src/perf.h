@@ -0,0 +1,42 @@
+#ifndef SLPM_PERF_HEADER
+#define SLPM_PERF_HEADER
+
+// With SLPM_PERF=1 every stage accumulates the cycles, instructions, last
+// level cache misses, dTLB misses and page faults of this process, its
+// threads and the children it forks, and perf_report prints them as a
+// table. Counters the kernel refuses are shown as '-', without any the table
+// still carries calls and wall time.
+enum class Stage {
+	  startup
+	, kdf
+	, seed
+	, keygen
+};
+
+void perf_init();
+void perf_begin(Stage);
+void perf_end(Stage);
+void perf_report(int fd);
+
+struct PerfScope {
+	explicit PerfScope(Stage stage) : stage_(stage) { perf_begin(stage_); }
+	~PerfScope() { perf_end(stage_); }
+	PerfScope(const PerfScope&) = delete;
+	PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+	Stage stage_;
+};
+
+// reports however the scope it lives in is left
+struct PerfReport {
+	explicit PerfReport(int fd) : fd_(fd) {}
+	~PerfReport() { perf_report(fd_); }
+	PerfReport(const PerfReport&) = delete;
+	PerfReport& operator=(const PerfReport&) = delete;
+
+private:
+	int fd_;
+};
+
+#endif // SLPM_PERF_HEADER
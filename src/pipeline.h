@@ -0,0 +1,46 @@
+#ifndef SLPM_PIPELINE_HEADER
+#define SLPM_PIPELINE_HEADER
+
+#include "mpw.h"
+#include "arena.h"
+#include "utils.h"
+#include "perf.h"
+
+#include <cstring>
+
+// The derivation pipeline of a build: master key (Kdf), site seed (Mac) and
+// what becomes of the seed, a generic password or an ssh key (Signer), each
+// query's records written to the Sink it is handed. Every stage is a
+// template parameter, so a build fixing one of them (see the variants in the
+// Makefile) neither dispatches at run time nor links the alternatives.
+template <typename Kdf, typename Mac, typename Signer>
+struct Pipeline {
+	Kdf kdf;
+	Mac mac;
+
+	void
+	site(Signer& signer, Sink& sink, const uint8_t* key, size_t keysize, const char* site, int counter) const
+	{
+		const auto is_ssh = !strncmp(site, "ssh ", 4);
+		if (is_ssh) site += 4;
+		ScratchObject<Seed> seed;
+		if (!seed.valid()) return;
+		perf_begin(Stage::seed);
+		const int error = mac.seed(*seed, key, keysize, site, counter);
+		perf_end(Stage::seed);
+		if (error) {
+			writes(2, "hmac fail\n");
+			return;
+		}
+		// the message the seed was computed from may have been truncated
+		if (arena_exhausted()) return;
+
+		if (is_ssh) {
+			signer.key(sink, *seed, site, counter);
+		} else {
+			output_site_generic(sink, *seed, site, counter);
+		}
+	}
+};
+
+#endif // SLPM_PIPELINE_HEADER
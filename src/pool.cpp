@@ -0,0 +1,179 @@
+#include "pool.h"
+
+#include "utils.h"
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+extern "C" {
+int clone_thread(unsigned long flags, void* stack_top, void (*fn)(void*), void* arg);
+long futex(int* uaddr, int op, int val, const void* timeout);
+int rt_sigprocmask(int how, const void* set, void* oldset, size_t sigsetsize);
+}
+
+static const std::size_t stack_size = 64 * 1024;
+
+// the tasks a worker has yet to take, guarded by a spinlock
+struct alignas(64) Deque {
+	int lock;
+	int lo;
+	int hi;
+};
+
+struct Job {
+	PoolTask task;
+	void* ctx;
+	const volatile bool* quit;
+};
+
+static Deque deques[pool_max_workers];
+static Job job;
+static int threads = -1;
+static uint8_t* stacks = nullptr;
+static int generation = 0;
+static int running = 0;
+
+static void
+lock(Deque& d)
+{
+	while (__atomic_exchange_n(&d.lock, 1, __ATOMIC_ACQUIRE)) __builtin_ia32_pause();
+}
+
+static void
+unlock(Deque& d)
+{
+	__atomic_store_n(&d.lock, 0, __ATOMIC_RELEASE);
+}
+
+static bool
+take(int w, int& task)
+{
+	auto& d = deques[w];
+	lock(d);
+	const bool found = d.lo != d.hi;
+	if (found) task = d.lo++;
+	unlock(d);
+	return found;
+}
+
+// Moves the back half of the first non-empty deque after w's to w's, which
+// only its owner fills and is empty by now, and takes its first task.
+static bool
+steal(int w, int& task)
+{
+	const int workers = threads + 1;
+	for (int i = 1; i != workers; ++i) {
+		auto& victim = deques[(w + i) % workers];
+		lock(victim);
+		const int left = victim.hi - victim.lo;
+		const int lo = victim.hi - (left + 1) / 2;
+		const int hi = victim.hi;
+		victim.hi = lo;
+		unlock(victim);
+		if (!left) continue;
+		auto& own = deques[w];
+		lock(own);
+		own.lo = lo + 1;
+		own.hi = hi;
+		unlock(own);
+		task = lo;
+		return true;
+	}
+	return false;
+}
+
+static void
+work(int w)
+{
+	int task;
+	while (!*job.quit && (take(w, task) || steal(w, task))) job.task(job.ctx, task, w);
+}
+
+static void
+thread_main(void* arg)
+{
+	const int w = reinterpret_cast<intptr_t>(arg);
+	int seen = 0;
+	while (true) {
+		int g;
+		while ((g = __atomic_load_n(&generation, __ATOMIC_ACQUIRE)) == seen) {
+			futex(&generation, FUTEX_WAIT_PRIVATE, g, nullptr);
+		}
+		seen = g;
+		work(w);
+		if (!__atomic_sub_fetch(&running, 1, __ATOMIC_ACQ_REL)) {
+			futex(&running, FUTEX_WAKE_PRIVATE, 1, nullptr);
+		}
+	}
+}
+
+static void
+start_threads()
+{
+	threads = 0;
+	const int wanted = std::min(cpu_count(), pool_max_workers) - 1;
+	if (wanted <= 0) return;
+	stacks = static_cast<uint8_t*>(map_anonymous(wanted * stack_size, MAP_PRIVATE));
+	if (!stacks) return;
+	const unsigned long flags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND
+		| CLONE_THREAD | CLONE_SYSVSEM;
+	// signals are left to the main thread, which may be blocked in read: the
+	// workers inherit a mask blocking all of them, so none can be delivered
+	// to a worker before it runs
+	const uint64_t all = ~uint64_t(0);
+	uint64_t old;
+	rt_sigprocmask(SIG_BLOCK, &all, &old, sizeof(all));
+	for (int i = 0; i != wanted; ++i) {
+		uint8_t *const stack = stacks + i * stack_size;
+		// a guard page below each stack
+		mprotect(stack, 4096, PROT_NONE);
+		if (clone_thread(flags, stack + stack_size, thread_main, reinterpret_cast<void*>(i + 1)) < 0) break;
+		++threads;
+	}
+	rt_sigprocmask(SIG_SETMASK, &old, nullptr, sizeof(old));
+}
+
+int
+pool_workers()
+{
+	if (threads < 0) start_threads();
+	return threads + 1;
+}
+
+void
+pool_run(int n, PoolTask task, void* ctx, const volatile bool& quit)
+{
+	const int workers = pool_workers();
+	job.task = task;
+	job.ctx = ctx;
+	job.quit = &quit;
+	for (int w = 0; w != workers; ++w) {
+		deques[w].lo = n / workers * w + std::min(w, n % workers);
+		deques[w].hi = n / workers * (w + 1) + std::min(w + 1, n % workers);
+	}
+	if (threads) {
+		__atomic_store_n(&running, threads, __ATOMIC_RELEASE);
+		__atomic_add_fetch(&generation, 1, __ATOMIC_ACQ_REL);
+		futex(&generation, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+	}
+	work(0);
+	int r;
+	while ((r = __atomic_load_n(&running, __ATOMIC_ACQUIRE))) {
+		futex(&running, FUTEX_WAIT_PRIVATE, r, nullptr);
+	}
+}
+
+int
+pool_worker()
+{
+	const char here = 0;
+	const auto sp = reinterpret_cast<uintptr_t>(&here);
+	const auto base = reinterpret_cast<uintptr_t>(stacks);
+	if (!stacks || sp < base || sp - base >= threads * stack_size) return 0;
+	return 1 + (sp - base) / stack_size;
+}
@@ -0,0 +1,22 @@
+#ifndef SLPM_POOL_HEADER
+#define SLPM_POOL_HEADER
+
+// A fixed set of threads started with raw clone on mmapped stacks, one per
+// cpu besides the caller, parked on a futex between jobs.
+//
+// pool_run deals the tasks 0..n-1 out as one contiguous range per worker,
+// every worker takes tasks from the front of its own range and, once that
+// runs dry, steals the back half of another one. It returns when every task
+// ran or once quit is set, after the tasks already started finished.
+// Tasks must not call pool_run themselves.
+const int pool_max_workers = 64;
+
+using PoolTask = void (*)(void* ctx, int task, int worker);
+
+int pool_workers();
+void pool_run(int n, PoolTask task, void* ctx, const volatile bool& quit);
+
+// 0 on the caller of pool_run and any other thread, 1.. on the pool threads
+int pool_worker();
+
+#endif // SLPM_POOL_HEADER
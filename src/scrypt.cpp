@@ -0,0 +1,237 @@
+#include "scrypt.h"
+
+#include "arena.h"
+#include "pool.h"
+
+#include <sodium/crypto_auth_hmacsha256.h>
+#include <sodium/crypto_pwhash_scryptsalsa208sha256.h>
+#include <sodium/utils.h>
+
+#include <sys/mman.h>
+#include <cstring>
+#include <algorithm>
+#include <array>
+
+const Romix*
+romix_mode(const char* name)
+{
+	static const Romix modes[] = {
+		  Romix::reference
+		, Romix::sequential
+		, Romix::interleaved
+		, Romix::threaded
+	};
+	static const char* names[] = { "reference", "sequential", "interleaved", "threaded" };
+	for (unsigned i = 0; i != sizeof(names) / sizeof(names[0]); ++i) {
+		if (!strcmp(name, names[i])) return &modes[i];
+	}
+	return nullptr;
+}
+
+// PBKDF2-HMAC-SHA256 with a single iteration, all scrypt asks for
+static int
+pbkdf2_sha256(const uint8_t* pw, size_t pwlen, const uint8_t* salt, size_t saltlen, uint8_t* out, size_t outlen)
+{
+	crypto_auth_hmacsha256_state pwsalt, state;
+	uint8_t t[crypto_auth_hmacsha256_BYTES];
+	int error = crypto_auth_hmacsha256_init(&pwsalt, pw, pwlen)
+		|| crypto_auth_hmacsha256_update(&pwsalt, salt, saltlen);
+	for (uint32_t i = 1; !error && outlen; ++i) {
+		const uint8_t index[] = {
+			  static_cast<uint8_t>(i >> 24)
+			, static_cast<uint8_t>(i >> 16)
+			, static_cast<uint8_t>(i >> 8)
+			, static_cast<uint8_t>(i)
+		};
+		state = pwsalt;
+		error = crypto_auth_hmacsha256_update(&state, index, sizeof(index))
+			|| crypto_auth_hmacsha256_final(&state, t);
+		const size_t n = std::min(outlen, sizeof(t));
+		memcpy(out, t, n);
+		out += n;
+		outlen -= n;
+	}
+	sodium_memzero(&pwsalt, sizeof(pwsalt));
+	sodium_memzero(&state, sizeof(state));
+	sodium_memzero(t, sizeof(t));
+	return error ? -1 : 0;
+}
+
+#define ROTL(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
+
+static void
+salsa20_8(uint32_t B[16])
+{
+	uint32_t x[16];
+	memcpy(x, B, sizeof(x));
+	for (int i = 0; i != 8; i += 2) {
+		x[ 4] ^= ROTL(x[ 0] + x[12],  7);  x[ 8] ^= ROTL(x[ 4] + x[ 0],  9);
+		x[12] ^= ROTL(x[ 8] + x[ 4], 13);  x[ 0] ^= ROTL(x[12] + x[ 8], 18);
+		x[ 9] ^= ROTL(x[ 5] + x[ 1],  7);  x[13] ^= ROTL(x[ 9] + x[ 5],  9);
+		x[ 1] ^= ROTL(x[13] + x[ 9], 13);  x[ 5] ^= ROTL(x[ 1] + x[13], 18);
+		x[14] ^= ROTL(x[10] + x[ 6],  7);  x[ 2] ^= ROTL(x[14] + x[10],  9);
+		x[ 6] ^= ROTL(x[ 2] + x[14], 13);  x[10] ^= ROTL(x[ 6] + x[ 2], 18);
+		x[ 3] ^= ROTL(x[15] + x[11],  7);  x[ 7] ^= ROTL(x[ 3] + x[15],  9);
+		x[11] ^= ROTL(x[ 7] + x[ 3], 13);  x[15] ^= ROTL(x[11] + x[ 7], 18);
+
+		x[ 1] ^= ROTL(x[ 0] + x[ 3],  7);  x[ 2] ^= ROTL(x[ 1] + x[ 0],  9);
+		x[ 3] ^= ROTL(x[ 2] + x[ 1], 13);  x[ 0] ^= ROTL(x[ 3] + x[ 2], 18);
+		x[ 6] ^= ROTL(x[ 5] + x[ 4],  7);  x[ 7] ^= ROTL(x[ 6] + x[ 5],  9);
+		x[ 4] ^= ROTL(x[ 7] + x[ 6], 13);  x[ 5] ^= ROTL(x[ 4] + x[ 7], 18);
+		x[11] ^= ROTL(x[10] + x[ 9],  7);  x[ 8] ^= ROTL(x[11] + x[10],  9);
+		x[ 9] ^= ROTL(x[ 8] + x[11], 13);  x[10] ^= ROTL(x[ 9] + x[ 8], 18);
+		x[12] ^= ROTL(x[15] + x[14],  7);  x[13] ^= ROTL(x[12] + x[15],  9);
+		x[14] ^= ROTL(x[13] + x[12], 13);  x[15] ^= ROTL(x[14] + x[13], 18);
+	}
+	for (int i = 0; i != 16; ++i) B[i] += x[i];
+}
+
+// Y = BlockMix(B) for the 2r 64 byte blocks of B, the even results go to the
+// first half of Y and the odd ones to the second.
+static void
+blockmix_salsa8(const uint32_t* B, uint32_t* Y, uint32_t r)
+{
+	uint32_t X[16];
+	memcpy(X, &B[(2 * r - 1) * 16], sizeof(X));
+	for (uint32_t i = 0; i != 2 * r; ++i) {
+		for (int k = 0; k != 16; ++k) X[k] ^= B[i * 16 + k];
+		salsa20_8(X);
+		memcpy(&Y[(i / 2 + (i & 1) * r) * 16], X, sizeof(X));
+	}
+}
+
+// One scrypt lane: B is its part of the PBKDF2 output, V the N blocks it
+// fills and then reads back in random order, x and y its working blocks.
+struct Lane {
+	uint8_t* B;
+	uint32_t* V;
+	uint32_t* x;
+	uint32_t* y;
+	uint32_t j;
+};
+
+static void
+prefetch_block(const uint32_t* p, uint32_t r)
+{
+	for (uint32_t o = 0; o < 32 * r; o += 16) __builtin_prefetch(p + o);
+}
+
+// ROMix of n lanes in lockstep. The next V block of a lane is known as soon
+// as its BlockMix is done, so it is prefetched then and arrives while the
+// other lanes compute: with two lanes the random reads of phase 2 stop
+// stalling a single core.
+static void
+smix(Lane* lanes, int n, uint32_t N, uint32_t r)
+{
+	const uint32_t words = 32 * r;
+	for (int l = 0; l != n; ++l) {
+		auto& lane = lanes[l];
+		for (uint32_t k = 0; k != words; ++k) {
+			const uint8_t* b = &lane.B[4 * k];
+			lane.x[k] = b[0] | b[1] << 8 | b[2] << 16 | static_cast<uint32_t>(b[3]) << 24;
+		}
+	}
+	for (uint32_t i = 0; i != N; ++i) {
+		for (int l = 0; l != n; ++l) {
+			auto& lane = lanes[l];
+			memcpy(&lane.V[i * words], lane.x, words * 4);
+			blockmix_salsa8(lane.x, lane.y, r);
+			std::swap(lane.x, lane.y);
+		}
+	}
+	for (int l = 0; l != n; ++l) {
+		auto& lane = lanes[l];
+		lane.j = lane.x[(2 * r - 1) * 16] & (N - 1);
+		prefetch_block(&lane.V[lane.j * words], r);
+	}
+	for (uint32_t i = 0; i != N; ++i) {
+		for (int l = 0; l != n; ++l) {
+			auto& lane = lanes[l];
+			const uint32_t* v = &lane.V[lane.j * words];
+			for (uint32_t k = 0; k != words; ++k) lane.x[k] ^= v[k];
+			blockmix_salsa8(lane.x, lane.y, r);
+			std::swap(lane.x, lane.y);
+			lane.j = lane.x[(2 * r - 1) * 16] & (N - 1);
+			prefetch_block(&lane.V[lane.j * words], r);
+		}
+	}
+	for (int l = 0; l != n; ++l) {
+		auto& lane = lanes[l];
+		for (uint32_t k = 0; k != words; ++k) {
+			uint8_t* b = &lane.B[4 * k];
+			b[0] = lane.x[k];
+			b[1] = lane.x[k] >> 8;
+			b[2] = lane.x[k] >> 16;
+			b[3] = lane.x[k] >> 24;
+		}
+	}
+}
+
+struct Lanes {
+	Lane* lanes;
+	uint32_t N;
+	uint32_t r;
+};
+
+static void
+smix_task(void* ctx, int task, int)
+{
+	const auto& s = *static_cast<const Lanes*>(ctx);
+	smix(&s.lanes[task], 1, s.N, s.r);
+}
+
+int
+scrypt(Romix mode, const uint8_t* pw, size_t pwlen, const uint8_t* salt, size_t saltlen, uint32_t N, uint32_t r, uint32_t p, uint8_t* key, size_t keysize)
+{
+	if (mode == Romix::reference) {
+		return crypto_pwhash_scryptsalsa208sha256_ll(pw, pwlen, salt, saltlen, N, r, p, key, keysize);
+	}
+	// the limits of libsodium, besides at most one lane per pool task slot
+	if (N < 2 || (N & (N - 1)) || !r || !p || p > 64 || static_cast<uint64_t>(r) * p >= 1 << 30) return -1;
+
+	// every lane running at the same time needs a V and working blocks, when
+	// there is not enough memory for that the lanes run one after the other
+	uint32_t active = mode == Romix::sequential ? 1 : mode == Romix::interleaved ? std::min(p, 2u) : p;
+	uint64_t region;
+	const auto map_lanes = [&](uint32_t n) {
+		region = (N + 2ull) * 128 * r * n;
+		return region == static_cast<size_t>(region) ? static_cast<uint32_t*>(map_secret(region, MAP_PRIVATE)) : nullptr;
+	};
+	uint32_t* mem = map_lanes(active);
+	if (!mem && active > 1) mem = map_lanes(active = 1);
+	if (!mem) return -1;
+	const uint32_t words = 32 * r;
+	uint8_t *const B = static_cast<uint8_t*>(map_secret(p * words * 4, MAP_PRIVATE));
+	if (!B) {
+		munmap(mem, region);
+		return -1;
+	}
+
+	std::array<Lane, 64> lanes;
+	for (uint32_t i = 0; i != p; ++i) {
+		uint32_t *const slot = mem + (i % active) * (N + 2) * words;
+		lanes[i] = Lane{ B + i * words * 4, slot, slot + N * words, slot + (N + 1) * words, 0 };
+	}
+
+	int error = pbkdf2_sha256(pw, pwlen, salt, saltlen, B, p * words * 4);
+	if (!error) {
+		if (mode == Romix::threaded && active == p) {
+			static const volatile bool never = false;
+			Lanes s{ lanes.data(), N, r };
+			pool_run(p, smix_task, &s, never);
+		} else {
+			for (uint32_t i = 0; i < p; i += active) {
+				smix(&lanes[i], std::min(active, p - i), N, r);
+			}
+		}
+		error = pbkdf2_sha256(pw, pwlen, B, p * words * 4, key, keysize);
+	}
+
+	for (uint32_t i = 0; i != active; ++i) {
+		sodium_memzero(mem + (i * (N + 2) + N) * words, 2 * words * 4);
+	}
+	sodium_memzero(B, p * words * 4);
+	munmap(B, p * words * 4);
+	munmap(mem, region);
+	return error;
+}
@@ -0,0 +1,22 @@
+#ifndef SLPM_SCRYPT_HEADER
+#define SLPM_SCRYPT_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+// How the p lanes of scrypt run their ROMix. Every mode yields the same key.
+enum class Romix {
+	  reference // libsodium, one lane after the other
+	, sequential // ours, one lane after the other
+	, interleaved // two lanes at a time on one core, prefetching V
+	, threaded // every lane on a pool thread of its own
+};
+
+const Romix* romix_mode(const char* name);
+
+// scrypt with our own ROMix, the reference mode calls libsodium instead.
+// Like libsodium's it returns -1 for an N which is not a power of 2 or when
+// the memory of V cannot be mapped.
+int scrypt(Romix, const uint8_t* pw, size_t pwlen, const uint8_t* salt, size_t saltlen, uint32_t N, uint32_t r, uint32_t p, uint8_t* key, size_t keysize);
+
+#endif // SLPM_SCRYPT_HEADER
@@ -0,0 +1,154 @@
+#include "search.h"
+
+#include "mpw.h"
+#include "arena.h"
+#include "utils.h"
+#include "buffer.h"
+#include "pool.h"
+
+#include <sys/mman.h>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
+
+static const size_t sites_size = 1 << 20;
+
+template <typename Mac>
+struct Query {
+	const Mac* mac;
+	const uint8_t* key;
+	size_t keysize;
+	const char* password;
+	unsigned mask;
+	int first;
+	int last;
+};
+
+template <typename Mac>
+struct Search {
+	Query<Mac> q;
+	const char** sites;
+	std::array<unsigned, pool_max_workers> counts;
+	int fd;
+	const volatile bool* quit;
+};
+
+// a task tries every counter of the range for one site
+template <typename Mac>
+static void
+search_site(void* ctx, int i, int worker)
+{
+	auto& s = *static_cast<Search<Mac>*>(ctx);
+	const auto& q = s.q;
+	const char *const site = s.sites[i];
+	// stops at last before incrementing, so INT_MAX ends the range too
+	for (int counter = q.first; !*s.quit; ++counter) {
+		ScratchObject<Seed> seed;
+		if (!seed.valid()) break;
+		if (q.mac->seed(*seed, q.key, q.keysize, site, counter)) continue;
+		if (arena_exhausted()) break;
+		const unsigned found = match_site_generic(*seed, q.password, q.mask);
+		for (unsigned t = 0; found >> t; ++t) {
+			if (!(found & (1u << t))) continue;
+			Buffer<uint8_t, 512> buf;
+			buf += "Match: ";
+			buf += site;
+			buf += ' ';
+			buf.append_signed_decimal(counter);
+			buf += ' ';
+			buf += template_name(t);
+			buf += '\n';
+			buf.write(s.fd);
+			++s.counts[worker];
+		}
+		if (counter == q.last) break;
+	}
+}
+
+static int
+read_sites(char* sites)
+{
+	int n = 0;
+	char* last = sites;
+	while (const char* s = getstring("Sites: ")) {
+		if (!*s) break;
+		const size_t len = strlen(s) + 1;
+		if (last + len > sites + sites_size) {
+			writes(STDERR_FILENO, "Site list is full, site ignored\n");
+			continue;
+		}
+		memcpy(last, s, len);
+		last += len;
+		++n;
+	}
+	return n;
+}
+
+// Every site is a task for the thread pool, matches are printed as they are
+// found and counted per worker.
+template <typename Mac>
+void
+search_sites(const Mac& mac, const uint8_t* key, size_t keysize, const char* password, const char* counters, int fd, const volatile bool& quit)
+{
+	Search<Mac> s;
+	auto& q = s.q;
+	q.mac = &mac;
+	q.key = key;
+	q.keysize = keysize;
+	q.password = password;
+	q.mask = templates_of_length(strlen(password));
+	// counters may be negative, "-3--1" is the range from -3 to -1
+	const char* end = parse_int(counters, q.first);
+	if (end && *end == '-') {
+		end = parse_int(end + 1, q.last);
+	} else {
+		q.last = q.first;
+	}
+	if (!end || *end || q.last < q.first) {
+		writes(STDERR_FILENO, "Invalid counter range, use <first>[-<last>]\n");
+		return;
+	}
+	s.counts.fill(0);
+	s.fd = fd;
+	s.quit = &quit;
+
+	char *const sites = static_cast<char*>(map_anonymous(sites_size, MAP_PRIVATE));
+	if (!sites) {
+		writes(STDERR_FILENO, "mmap fail\n");
+		return;
+	}
+	const int nsites = read_sites(sites);
+	const size_t index_size = std::max(nsites, 1) * sizeof(char*);
+	s.sites = static_cast<const char**>(map_anonymous(index_size, MAP_PRIVATE));
+	if (!s.sites) {
+		writes(STDERR_FILENO, "mmap fail\n");
+		sodium_memzero(sites, sites_size);
+		munmap(sites, sites_size);
+		return;
+	}
+	const char* site = sites;
+	for (int i = 0; i != nsites; ++i, site += strlen(site) + 1) s.sites[i] = site;
+
+	if (!q.mask) {
+		writes(STDERR_FILENO, "No template generates passwords of this length\n");
+	} else {
+		pool_run(nsites, search_site<Mac>, &s, quit);
+	}
+
+	unsigned total = 0;
+	for (const auto c : s.counts) total += c;
+	Buffer<uint8_t, 64> buf;
+	buf += "Found ";
+	buf.append_decimal(total);
+	buf += total == 1 ? " match.\n" : " matches.\n";
+	buf.write(fd);
+
+	sodium_memzero(sites, sites_size);
+	munmap(sites, sites_size);
+	munmap(s.sites, index_size);
+}
+
+template void search_sites(const HmacSha256Mac&, const uint8_t*, size_t, const char*, const char*, int, const volatile bool&);
+template void search_sites(const Blake2bMac&, const uint8_t*, size_t, const char*, const char*, int, const volatile bool&);
+template void search_sites(const RuntimeMac&, const uint8_t*, size_t, const char*, const char*, int, const volatile bool&);
@@ -0,0 +1,14 @@
+#ifndef SLPM_SEARCH_HEADER
+#define SLPM_SEARCH_HEADER
+
+#include <cstddef>
+#include <cstdint>
+
+// Reads site names until an empty line and reports every site and counter
+// in the "<first>[-<last>]" range whose generic passwords include password
+// to fd, the one the prompts go to. Instantiated for the seed MAC policies of
+// mpw.h.
+template <typename Mac>
+void search_sites(const Mac&, const uint8_t* key, std::size_t keysize, const char* password, const char* counters, int fd, const volatile bool& quit);
+
+#endif // SLPM_SEARCH_HEADER
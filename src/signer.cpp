@@ -0,0 +1,72 @@
+#include "signer.h"
+
+#include "buffer.h"
+#include "arena.h"
+#include "utils.h"
+#include "sink.h"
+#include "perf.h"
+#include "base64.h"
+
+#include <sodium/crypto_hash_sha256.h>
+
+#include <cassert>
+#include <algorithm>
+
+template <typename B>
+static void
+append_base64(B& result, const void* data, size_t len, bool pad = true)
+{
+	result.append_from([&](auto* dst, ptrdiff_t room) {
+		return base64_encode(reinterpret_cast<char*>(dst), room, data, len, pad);
+	});
+}
+
+extern "C" int crypto_sign_keypair_from_seed(uint8_t *pk, uint8_t *sk);
+
+void
+Ed25519Signer::key(Sink& sink, const Seed& seed, const char* site, int counter)
+{
+	assert(seed.size() >= crypto_sign_ed25519_SEEDBYTES);
+	ScratchObject<Ed25519KeyPair> k;
+	if (!k.valid()) return;
+	std::copy_n(seed.begin(), seed.size(), k->sec.begin());
+	perf_begin(Stage::keygen);
+	crypto_sign_keypair_from_seed(k->pub.data(), k->sec.data());
+	perf_end(Stage::keygen);
+	ScratchBuffer<char, 256> comment;
+	comment += "slpm+";
+	comment += site;
+	comment += '\0';
+	const auto error = arena_exhausted() ? -1 : agent_.add(*k, comment.data());
+	sodium_memzero(k->sec.data(), k->sec.size());
+
+	if (!error) {
+		ScratchBuffer<char, 256> blob;
+		blob.append_with_be32_length_prefix("ssh-ed25519");
+		blob.append_with_be32_length_prefix(reinterpret_cast<const char*>(k->pub.data()), k->pub.size());
+		ScratchBuffer<uint8_t, 4096> buf;
+		buf += "ssh-ed25519";
+		buf += ' ';
+		append_base64(buf, blob.data(), blob.size());
+		buf += ' ';
+		buf += getenv_or("USER", "user");
+		buf += '@';
+		buf += "slpm+";
+		buf += site;
+		sink.public_key(site, counter, reinterpret_cast<const char*>(buf.data()), buf.size());
+		if (fingerprints) {
+			std::array<uint8_t, crypto_hash_sha256_BYTES> hash;
+			crypto_hash_sha256(hash.data(), reinterpret_cast<const uint8_t*>(blob.data()), blob.size());
+			ScratchBuffer<char, 64> fp;
+			fp += "SHA256:";
+			append_base64(fp, hash.data(), hash.size(), false);
+			sink.fingerprint(site, counter, fp.data(), fp.size());
+		}
+	}
+}
+
+void
+NoSigner::key(Sink&, const Seed&, const char*, int)
+{
+	writes(2, "This build has no ssh key support\n");
+}
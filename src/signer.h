@@ -0,0 +1,28 @@
+#ifndef SLPM_SIGNER_HEADER
+#define SLPM_SIGNER_HEADER
+
+#include "ssh-agent.h"
+#include "mpw.h"
+
+// Signer policies of the pipeline (see pipeline.h), they turn the seed of an
+// "ssh <site>" into whatever the build does with ssh keys.
+
+// Adds an ed25519 key to the ssh agent and prints its public key, followed by
+// its SHA256 fingerprint when asked to.
+struct Ed25519Signer {
+	bool fingerprints = false;
+
+	void key(Sink&, const Seed&, const char* site, int counter);
+
+private:
+	SshAgent agent_;
+};
+
+// For builds without ssh support, which then link no ed25519 code.
+struct NoSigner {
+	bool fingerprints = false;
+
+	void key(Sink&, const Seed&, const char* site, int counter);
+};
+
+#endif // SLPM_SIGNER_HEADER
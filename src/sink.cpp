@@ -0,0 +1,218 @@
+#include "sink.h"
+
+#include "arena.h"
+#include "utils.h"
+
+#include <sodium/utils.h>
+
+#include <sys/mman.h>
+#include <cerrno>
+#include <cstring>
+
+using Record = ScratchBuffer<char, 2048>;
+
+const OutputFormat*
+output_format(const char* name)
+{
+	static const OutputFormat formats[] = {
+		  OutputFormat::text
+		, OutputFormat::tsv
+		, OutputFormat::jsonl
+		, OutputFormat::binary
+	};
+	static const char* names[] = { "text", "tsv", "jsonl", "binary" };
+	for (unsigned i = 0; i != sizeof(names) / sizeof(names[0]); ++i) {
+		if (!strcmp(name, names[i])) return &formats[i];
+	}
+	return nullptr;
+}
+
+static void
+append_tsv(Record& rec, const char* s, size_t len)
+{
+	for (const char* end = s + len; s != end; ++s) {
+		switch (*s) {
+		case '\t': rec += "\\t"; break;
+		case '\n': rec += "\\n"; break;
+		case '\\': rec += "\\\\"; break;
+		default: rec += *s;
+		}
+	}
+}
+
+static void
+append_json(Record& rec, const char* s, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	rec += '"';
+	for (const char* end = s + len; s != end; ++s) {
+		const auto c = static_cast<unsigned char>(*s);
+		if (c == '"' || c == '\\') {
+			rec += '\\';
+			rec += c;
+		} else if (c < 0x20) {
+			rec += "\\u00";
+			rec += hex[c >> 4];
+			rec += hex[c & 15];
+		} else {
+			rec += c;
+		}
+	}
+	rec += '"';
+}
+
+Sink::Sink(OutputFormat format, int fd)
+: format_(format)
+, fd_(fd)
+, region_(static_cast<char*>(map_secret(pages * page_size, MAP_PRIVATE)))
+{
+	reset();
+}
+
+Sink::~Sink()
+{
+	flush();
+	if (region_) {
+		sodium_memzero(region_, pages * page_size);
+		munmap(region_, pages * page_size);
+	}
+}
+
+void
+Sink::reset()
+{
+	n_ = 0;
+	for (int i = 0; i != pages; ++i) {
+		iov_[i].iov_base = region_ + i * page_size;
+		iov_[i].iov_len = 0;
+	}
+}
+
+void
+Sink::password(const char* site, int counter, const char* name, const char* pw, size_t len)
+{
+	record(site, counter, name, pw, len, true);
+}
+
+void
+Sink::public_key(const char* site, int counter, const char* line, size_t len)
+{
+	record(site, counter, "ssh-ed25519", line, len, false);
+}
+
+void
+Sink::fingerprint(const char* site, int counter, const char* fp, size_t len)
+{
+	if (format_ != OutputFormat::text) {
+		record(site, counter, "fingerprint", fp, len, false);
+		return;
+	}
+	Record line;
+	line += "256 ";
+	line.append(fp, len);
+	line += " slpm+";
+	line += site;
+	line += " (ED25519)";
+	record(site, counter, "fingerprint", line.data(), line.size(), false);
+}
+
+void
+Sink::record(const char* site, int counter, const char* type, const char* value, size_t len, bool label)
+{
+	Record rec;
+	// the record, or the value handed in, may have been truncated
+	if (arena_exhausted()) return;
+	switch (format_) {
+	case OutputFormat::text:
+		if (label) {
+			rec += type;
+			rec += ": ";
+		}
+		rec.append(value, len);
+		rec += '\n';
+		break;
+	case OutputFormat::tsv:
+		append_tsv(rec, site, strlen(site));
+		rec += '\t';
+		rec.append_signed_decimal(counter);
+		rec += '\t';
+		rec += type;
+		rec += '\t';
+		append_tsv(rec, value, len);
+		rec += '\n';
+		break;
+	case OutputFormat::jsonl:
+		rec += "{\"site\":";
+		append_json(rec, site, strlen(site));
+		rec += ",\"counter\":";
+		rec.append_signed_decimal(counter);
+		rec += ",\"type\":";
+		append_json(rec, type, strlen(type));
+		rec += ",\"value\":";
+		append_json(rec, value, len);
+		rec += "}\n";
+		break;
+	case OutputFormat::binary:
+		rec.append_network_long(0);
+		rec.append_with_be32_length_prefix(site);
+		rec.append_network_long(counter);
+		rec.append_with_be32_length_prefix(type);
+		rec.append_with_be32_length_prefix(value, len);
+		*reinterpret_cast<uint32_t*>(rec.data()) = htonl(rec.size() - 4);
+		break;
+	}
+	append(rec.data(), rec.size());
+}
+
+void
+Sink::append(const char* data, size_t len)
+{
+	if (!region_) {
+		iovec iov{ const_cast<char*>(data), len };
+		write_out(&iov, 1);
+		return;
+	}
+	if (iov_[n_].iov_len + len > page_size && ++n_ == pages) {
+		n_ = pages - 1;
+		flush();
+	}
+	auto& iov = iov_[n_];
+	memcpy(static_cast<char*>(iov.iov_base) + iov.iov_len, data, len);
+	iov.iov_len += len;
+}
+
+// Writes iovecs until all of them are written. A call which fails or writes
+// nothing is reported once and keeps its error, the fd is not written again.
+bool
+Sink::write_out(iovec* iov, int cnt)
+{
+	while (cnt && !error_) {
+		const ssize_t n = writev(fd_, iov, cnt);
+		if (n == -EINTR) continue;
+		if (n <= 0) {
+			error_ = n ? n : -EIO;
+			writes(STDERR_FILENO, "Failed to write output\n");
+			break;
+		}
+		size_t left = n;
+		for (; cnt && left >= iov->iov_len; ++iov, --cnt) left -= iov->iov_len;
+		if (cnt) {
+			iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+			iov->iov_len -= left;
+		}
+	}
+	return !error_;
+}
+
+// The pages are copied out rather than spliced into a pipe: a spliced page
+// stays referenced by the pipe and could not be wiped.
+bool
+Sink::flush()
+{
+	if (!region_ || (!n_ && !iov_[0].iov_len)) return !error_;
+	const int cnt = n_ + 1;
+	write_out(iov_.data(), cnt);
+	sodium_memzero(region_, cnt * page_size);
+	reset();
+	return !error_;
+}
@@ -0,0 +1,55 @@
+#ifndef SLPM_SINK_HEADER
+#define SLPM_SINK_HEADER
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstddef>
+
+enum class OutputFormat {
+	  text
+	, tsv
+	, jsonl
+	, binary
+};
+
+const OutputFormat* output_format(const char* name);
+
+// Records are formatted into the pages of a locked anonymous mapping, one iovec
+// per page. A full mapping or a flush copies them out with writev and wipes
+// the pages. After a failed write the rest of the output is dropped.
+struct Sink {
+	explicit Sink(OutputFormat format, int fd = STDOUT_FILENO);
+	~Sink();
+	Sink(const Sink&) = delete;
+	Sink& operator=(const Sink&) = delete;
+
+	OutputFormat format() const { return format_; }
+	bool failed() const { return error_; }
+
+	void password(const char* site, int counter, const char* name, const char* pw, std::size_t len);
+	void public_key(const char* site, int counter, const char* line, std::size_t len);
+	// as `ssh-add -l` shows it in text, the bare SHA256:... otherwise
+	void fingerprint(const char* site, int counter, const char* fp, std::size_t len);
+	// false once a write has failed
+	bool flush();
+
+private:
+	static const std::size_t page_size = 4096;
+	static const int pages = 64;
+
+	void record(const char* site, int counter, const char* type, const char* value, std::size_t len, bool label);
+	void append(const char* data, std::size_t len);
+	bool write_out(iovec* iov, int cnt);
+	void reset();
+
+	OutputFormat format_;
+	int fd_;
+	char* region_;
+	std::array<iovec, pages> iov_;
+	int n_ = 0;
+	int error_ = 0;
+};
+
+#endif // SLPM_SINK_HEADER
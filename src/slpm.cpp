@@ -1,99 +1,200 @@
-#include "ssh-agent.h"
 #include "buffer.h"
 #include "fd.h"
 #include "utils.h"
 #include "mpw.h"
-
-#include <sodium/crypto_pwhash_scryptsalsa208sha256.h>
+#include "keyring.h"
+#include "search.h"
+#include "kdf.h"
+#include "sink.h"
+#include "perf.h"
+#include "signer.h"
+#include "pipeline.h"
+#include "arena.h"
 
 #include <cstring>
-#include <cassert>
 #include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include <algorithm>
 
+// Builds may fix the seed MAC and signer at compile time, see the variants
+// in the Makefile.
+#ifndef SLPM_MAC
+#define SLPM_MAC RuntimeMac
+#endif
+#ifndef SLPM_SIGNER
+#define SLPM_SIGNER Ed25519Signer
+#endif
+
+static Pipeline<ScryptKdf, SLPM_MAC, SLPM_SIGNER> pipeline;
+
+// the banner, prompts and progress go to stderr when stdout carries records
+static int ui = STDOUT_FILENO;
+
+using Key = std::array<uint8_t, 64>;
+using Passphrase = ScratchBuffer<char, 256>;
+
+struct Identity {
+	const char* fullname;
+	ptrdiff_t fullnamelen;
+	Buffer<uint8_t, 4096> salt;
+	Key* key;
+	bool cached;
+};
+
+// SLPM_FULLNAMES lists several identities separated by colons, their keys are
+// derived concurrently and a site is then picked by "<prefix>:<site>".
+// SLPM_FULLNAME is always a single full name, colons included.
+using Identities = std::array<Identity, 8>;
+
 static int
-hmacsha256(
-	  uint8_t *out
-	, const uint8_t *in, size_t inlen
-	, const uint8_t *k, size_t klen
-)
+parse_identities(Identities& ids, const char* fullnames, bool list, unsigned profile)
 {
-	struct crypto_auth_hmacsha256_state state;
-	if (crypto_auth_hmacsha256_init(&state, k, klen)) return -1;
-	if (crypto_auth_hmacsha256_update(&state, in, inlen)) return -2;
-	if (crypto_auth_hmacsha256_final(&state, out)) return -3;
-	return 0;
+	int n = 0;
+	for (const char* p = fullnames; ; ++p) {
+		const char* q = p;
+		while (*q && (*q != ':' || !list)) ++q;
+		if (n == static_cast<int>(ids.size())) {
+			writes(2, "Too many identities, at most 8 are supported\n");
+			return -1;
+		}
+		auto& id = ids[n++];
+		id.fullname = p;
+		id.fullnamelen = q - p;
+		id.salt += mpw_iv;
+		id.salt.append_with_be32_length_prefix(p, q - p);
+		if (profile) id.salt.append_network_long(profile);
+		// a truncated salt would silently yield another key
+		if (id.salt.size() != static_cast<ptrdiff_t>(strlen(mpw_iv) + 4 + (q - p) + (profile ? 4 : 0))) {
+			writes(2, "Full name too long\n");
+			return -1;
+		}
+		if (!*q) break;
+		p = q;
+	}
+	return n;
 }
 
-static void
-append(Buffer<uint8_t, 4096>& result, const Ed25519PublicKey& pk)
+static int
+read_passphrase(Passphrase& out, const Identity& id, int n)
 {
-	Buffer<char, 256> buf;
-	buf.append_with_be32_length_prefix("ssh-ed25519");
-	buf.append_with_be32_length_prefix(reinterpret_cast<const char*>(pk.data()), pk.size());
-
-	std::array<char, 256> base64;
-	to_base64(base64.data(), base64.size(), buf.data(), buf.size());
-
-	result += base64.data();
+	Buffer<char, 256> prompt;
+	if (n == 1) {
+		prompt += "Passphrase: ";
+	} else {
+		prompt += "Passphrase for '";
+		prompt.append(id.fullname, id.fullnamelen);
+		prompt += "': ";
+	}
+	prompt += '\0';
+	char *const pw = (isatty(STDIN_FILENO) ? mygetpass : getstring)(prompt.data());
+	if (!pw) {
+		writes(ui, "\n");
+		return -1;
+	}
+	out += pw;
+	out += '\0';
+	sodium_memzero(pw, strlen(pw));
+	return 0;
 }
 
-extern "C" int crypto_sign_keypair_from_seed(uint8_t *pk, uint8_t *sk);
-
-static void
-output_site_ssh(SshAgent& sa, const Seed& seed, const char* site)
+static int
+derive_key(const Identity& id, const Passphrase& pw)
 {
-	assert(seed.size() >= crypto_sign_ed25519_SEEDBYTES);
-	Ed25519KeyPair k;
-	std::copy_n(seed.begin(), seed.size(), k.sec.begin());
-	crypto_sign_keypair_from_seed(k.pub.data(), k.sec.data());
-	Buffer<char, 256> comment;
-	comment += "slpm+";
-	comment += site;
-	comment += '\0';
-	const auto error = sa.add(k, comment.data());
-	sodium_memzero(k.sec.data(), k.sec.size());
-
-	if (!error) {
-		Buffer<uint8_t, 4096> buf;
-		buf += "ssh-ed25519";
-		buf += ' ';
-		append(buf, k.pub);
-		buf += ' ';
-		buf += getenv_or("USER", "user");
-		buf += '@';
-		buf += "slpm+";
-		buf += site;
-		buf += '\n';
-		buf.write(STDOUT_FILENO);
+	if (pipeline.kdf.derive(pw.data(), id.salt.data(), id.salt.size(), id.key->data(), id.key->size())) {
+		writes(2, "scrypt fail\n");
+		return -1;
 	}
-	sodium_memzero(k.pub.data(), k.pub.size());
+	return 0;
 }
 
-static const char iv[] = "com.lyndir.masterpassword";
+using Passphrases = std::array<Passphrase, 8>;
 
-static void
-write_passwords_for_site(SshAgent& sa, const uint8_t* key, size_t keysize, const char* site, int counter)
+// Every identity but the first one is derived in a child process of its own,
+// so they run on separate cores with separate scrypt regions. The keys are
+// passed back through the shared mapping they live in.
+static int
+derive_keys(const Identities& ids, int n, const Passphrases& pws)
 {
-	const auto is_ssh = !strncmp(site, "ssh ", 4);
-	if (is_ssh) site += 4;
-	Buffer<uint8_t, 4096> buf;
-
-	buf += iv;
-	buf.append_with_be32_length_prefix(site);
-	buf.append_network_long(counter);
-	Seed seed;
-	if (hmacsha256(seed.data(), buf.data(), buf.size(), key, keysize)) {
-		writes(2, "hmac fail\n");
-		return;
+	std::array<pid_t, 8> pids;
+	pids.fill(-1);
+	int first = -1;
+	for (int i = 0; i != n; ++i) {
+		if (ids[i].cached) continue;
+		if (first == -1) {
+			first = i;
+			continue;
+		}
+		pids[i] = fork();
+		if (!pids[i]) _exit(derive_key(ids[i], pws[i]) ? 1 : 0);
+	}
+	int result = 0;
+	if (first != -1 && derive_key(ids[first], pws[first])) result = -1;
+	for (int i = 0; i != n; ++i) {
+		if (ids[i].cached || i == first) continue;
+		if (pids[i] < 0) {
+			if (derive_key(ids[i], pws[i])) result = -1;
+			continue;
+		}
+		int status;
+		if (waitpid(pids[i], &status, 0) != pids[i] || status) result = -1;
 	}
+	return result;
+}
 
-	if (is_ssh) {
-		output_site_ssh(sa, seed, site);
-	} else {
-		output_site_generic(seed);
+static const Identity*
+select_identity(const Identities& ids, int n, const char*& site)
+{
+	if (n == 1) return &ids[0];
+	const auto len = strlen(site);
+	const char* colon = static_cast<const char*>(memchr(site, ':', len));
+	if (!colon) {
+		writes(2, "Unknown identity, use <prefix of full name>:<site>\n");
+		return nullptr;
+	}
+	// a full name given completely wins over the longer ones it is a prefix
+	// of, any other prefix has to match a single identity
+	const auto plen = colon - site;
+	const Identity* found = nullptr;
+	int matches = 0;
+	for (int i = 0; i != n; ++i) {
+		if (plen > ids[i].fullnamelen || strncmp(ids[i].fullname, site, plen)) continue;
+		if (plen == ids[i].fullnamelen) {
+			found = &ids[i];
+			matches = 1;
+			break;
+		}
+		found = &ids[i];
+		++matches;
 	}
-	sodium_memzero(seed.data(), seed.size());
+	if (matches != 1) {
+		writes(2, matches ? "Ambiguous identity, use a longer prefix of the full name\n" : "Unknown identity, use <prefix of full name>:<site>\n");
+		return nullptr;
+	}
+	site = colon + 1;
+	return found;
+}
+
+// "portable" runs libsodium's ROMix, "auto" ours with a thread per lane or,
+// on a single cpu, with the lanes interleaved; corpus.sh holds every mode to
+// the reference corpus. The pool is not asked for its size here, its threads
+// must not be started before derive_keys forks.
+static const Romix*
+romix_from_env(const char* backend)
+{
+	const char *const fallback = strcmp(backend, "portable") ? cpu_count() > 1 ? "threaded" : "interleaved" : "reference";
+	const Romix *const romix = romix_mode(getenv_or("SLPM_ROMIX", fallback));
+	if (!romix) writes(2, "Unknown ROMix mode, use reference, sequential, interleaved or threaded\n");
+	return romix;
+}
+
+// a whole non-negative decimal number, -1 for anything else
+static int
+parse_count(const char* s)
+{
+	int v;
+	const char *const end = parse_int(s, v);
+	return end && !*end && v >= 0 ? v : -1;
 }
 
 static volatile bool quit = false;
@@ -105,54 +206,149 @@ quithandler(int)
 }
 
 int
-main(int, char* [], char* envp[])
+main(int argc, char* argv[], char* envp[])
 {
 	environ = envp;
+	perf_init();
+	const PerfReport report(STDERR_FILENO);
 	signal(SIGINT, quithandler);
 	signal(SIGQUIT, quithandler);
 	signal(SIGTERM, quithandler);
-	const char *const salt = getenv_or("SLPM_FULLNAME", "");
+	// "portable" keeps the reference implementations, for comparing against them
+	const char *const backend = getenv_or("SLPM_BACKEND", "auto");
+	if (argc > 1 && !strcmp(argv[1], "calibrate")) {
+		const Romix *const romix = romix_from_env(backend);
+		const int ms = argc > 2 ? parse_count(argv[2]) : 1000;
+		if (ms < 0) {
+			writes(2, "Invalid time, use slpm calibrate <milliseconds>\n");
+			return -1;
+		}
+		return romix ? kdf_calibrate(ms, *romix) : -1;
+	}
+	const char *const fullnames = getenv("SLPM_FULLNAMES");
+	const char *const salt = fullnames ? fullnames : getenv_or("SLPM_FULLNAME", "");
+	const char *const profile = getenv_or("SLPM_KDF_PROFILE", "0");
+	const int profile_id = parse_count(profile);
+	const bool kdf = profile_id >= 0 && pipeline.kdf.select(profile_id);
+	const char *const seed_name = getenv_or("SLPM_SEED", pipeline.mac.default_name(std::max(profile_id, 0)));
+	const bool seed = pipeline.mac.select(seed_name);
+	const OutputFormat *const format = output_format(getenv_or("SLPM_FORMAT", "text"));
+	if (format && *format != OutputFormat::text) {
+		ui = STDERR_FILENO;
+		set_prompt_fd(ui);
+	}
 	{
 		Buffer<uint8_t, 256> buf;
 		buf += "slpm ";
 		buf += VERSION;
 		buf += '\n';
-		buf += "SLPM_FULLNAME='";
+		buf += fullnames ? "SLPM_FULLNAMES='" : "SLPM_FULLNAME='";
 		buf += salt;
 		buf += "'\n";
-		buf.write(1);
+		if (profile_id) {
+			buf += "SLPM_KDF_PROFILE=";
+			buf += profile;
+			buf += '\n';
+		}
+		if (seed && pipeline.mac.algorithm() != SeedAlgorithm::hmacsha256) {
+			buf += "SLPM_SEED=";
+			buf += seed_name;
+			buf += '\n';
+		}
+		buf.write(ui);
 	}
+	if (!kdf) {
+		writes(2, "Unknown KDF profile, run 'slpm calibrate' for the list\n");
+		return -1;
+	}
+	if (!seed) {
+		Buffer<char, 128> error;
+		error += "Unknown seed algorithm, use ";
+		error += decltype(pipeline.mac)::names;
+		error += '\n';
+		error.write(2);
+		return -1;
+	}
+	if (!format) {
+		writes(2, "Unknown output format, use text, tsv, jsonl or binary\n");
+		return -1;
+	}
+	if (strcmp(backend, "auto") && strcmp(backend, "portable")) {
+		writes(2, "Unknown backend, use auto or portable\n");
+		return -1;
+	}
+	// besides the seed MACs the base64 encoder picks its SSSE3 code from the
+	// probe, whatever the Mac policy of this build needs
+	if (!strcmp(backend, "auto")) {
+		probe_cpu();
+		decltype(pipeline.mac)::init();
+	}
+	const Romix *const romix = romix_from_env(backend);
+	if (!romix) return -1;
+	pipeline.kdf.romix = *romix;
 
-	Buffer<uint8_t, 4096> buf;
-	buf += iv;
-	buf.append_with_be32_length_prefix(salt);
-
-	char *const pw = (isatty(STDIN_FILENO) ? mygetpass : getstring)("Passphrase: ");
-	if (!pw) {
-		writes(STDOUT_FILENO, "\n");
+	Identities ids;
+	const int n = parse_identities(ids, salt, fullnames, profile_id);
+	if (n < 0) return -1;
+	void *const keys = map_secret(n * sizeof(Key), MAP_SHARED);
+	if (!keys) {
+		writes(2, "mmap fail\n");
 		return -1;
 	}
-	writes(1, "Deriving key...");
-	uint8_t key[64];
-	if (crypto_pwhash_scryptsalsa208sha256_ll(
-		  (const uint8_t*)pw
-		, strlen(pw)
-		, buf.data()
-		, buf.size()
-		, 32768
-		, 8
-		, 2
-		, key
-		, sizeof(key)
-	)) {
-		sodium_memzero(pw, strlen(pw));
-		writes(2, "scrypt fail\n");
+
+	perf_end(Stage::startup);
+
+	const int keyring_timeout = parse_count(getenv_or("SLPM_KEYRING_TIMEOUT", "0"));
+	if (keyring_timeout < 0) {
+		writes(2, "Invalid SLPM_KEYRING_TIMEOUT, use a number of seconds\n");
 		return -1;
 	}
-	sodium_memzero(pw, strlen(pw));
+	bool derive = false;
+	{
+		// wiped as soon as the keys are derived, or by their destructors on errors
+		Passphrases pws;
+		for (int i = 0; i != n; ++i) {
+			auto& id = ids[i];
+			id.key = static_cast<Key*>(keys) + i;
+			id.cached = keyring_timeout && keyring_load(id.salt.data(), id.salt.size(), id.key->data(), id.key->size());
+			if (id.cached) {
+				// a script pipes the passphrase either way, it is no site name
+				if (!isatty(STDIN_FILENO)) {
+					char *const pw = getstring("");
+					if (pw) sodium_memzero(pw, strlen(pw));
+				}
+				continue;
+			}
+			if (read_passphrase(pws[i], id, n)) return -1;
+			derive = true;
+		}
+		// a truncated passphrase would yield another key
+		if (arena_exhausted()) return -1;
 
-	writes(1, "\rKey derivation complete.\n");
-	SshAgent sa;
+		if (derive) {
+			writes(ui, "Deriving key...");
+			PerfScope scope(Stage::kdf);
+			const int error = derive_keys(ids, n, pws);
+			for (auto& pw : pws) pw.clear();
+			if (error) return -1;
+		}
+	}
+	if (!derive) writes(ui, "Using cached key...");
+	for (int i = 0; i != n; ++i) {
+		const auto& id = ids[i];
+		if (!keyring_timeout || id.cached) continue;
+		if (!keyring_store(id.salt.data(), id.salt.size(), id.key->data(), id.key->size(), keyring_timeout)) {
+			writes(2, "Failed to cache key in session keyring\n");
+		}
+	}
+
+	writes(ui, "\rKey derivation complete.\n");
+	SLPM_SIGNER signer;
+	signer.fingerprints = atoi(getenv_or("SLPM_FINGERPRINT", "0"));
+	Sink sink(*format);
+	// batches are written once the pages of the sink fill up, but text is
+	// interleaved with the prompts and somebody typing waits for the answer
+	const bool flush_each = *format == OutputFormat::text || isatty(STDIN_FILENO);
 	while (true) {
 		char site[256];
 		const char* s = getstring("Site: ");
@@ -160,10 +356,38 @@ main(int, char* [], char* envp[])
 		strncpy(site, s, sizeof(site) - 1);
 		const char* c = getstring("Counter: ");
 		if (!c || quit) break;
-		write_passwords_for_site(sa, key, sizeof(key), site, atoi(c));
+		const char* name = site;
+		const Identity* id = select_identity(ids, n, name);
+		if (!id) continue;
+		if (!strncmp(name, "find ", 5)) {
+			writes(2, "Enter just find, the password is asked for without echo\n");
+			continue;
+		}
+		if (!strcmp(name, "find")) {
+			if (!sink.flush()) break;
+			// the next prompts reuse the buffer c and pw point into
+			char counters[64];
+			strncpy(counters, c, sizeof(counters) - 1);
+			counters[sizeof(counters) - 1] = '\0';
+			char *const pw = (isatty(STDIN_FILENO) ? mygetpass : getstring)("Password: ");
+			if (!pw) break;
+			Passphrase password;
+			password += pw;
+			password += '\0';
+			sodium_memzero(pw, strlen(pw));
+			if (!arena_exhausted()) {
+				search_sites(pipeline.mac, id->key->data(), id->key->size(), password.data(), counters, ui, quit);
+			}
+			if (arena_exhausted()) break;
+			continue;
+		}
+		pipeline.site(signer, sink, id->key->data(), id->key->size(), name, atoi(c));
+		if (arena_exhausted() || (flush_each ? !sink.flush() : sink.failed())) break;
 	}
+	sink.flush();
 
-	sodium_memzero(key, sizeof(key));
-	writes(1, "\rBye!    \n");
-	return 0;
+	sodium_memzero(keys, n * sizeof(Key));
+	munmap(keys, n * sizeof(Key));
+	writes(ui, "\rBye!    \n");
+	return arena_exhausted() ? -1 : 0;
 }
@@ -1,13 +1,58 @@
 #include "ssh-agent.h"
 
 #include "utils.h"
-#include "buffer.h"
+#include "arena.h"
 
 #include <sys/un.h>
 #include <sys/socket.h>
 #include <algorithm>
 
-extern "C" size_t to_base64(char *dst, size_t dst_len, const void *src, size_t src_len);
+static bool
+write_full(int fd, const uint8_t* p, size_t n)
+{
+	while (n) {
+		const ssize_t wr = write(fd, p, n);
+		if (wr <= 0) return false;
+		p += wr;
+		n -= wr;
+	}
+	return true;
+}
+
+static bool
+read_full(int fd, uint8_t* p, size_t n)
+{
+	while (n) {
+		const ssize_t rd = read(fd, p, n);
+		if (rd <= 0) return false;
+		p += rd;
+		n -= rd;
+	}
+	return true;
+}
+
+// Sends a request whose first four bytes are reserved for its length and
+// returns the type of the response, or -1 if the agent could not be talked to.
+// The response may arrive in any number of fragments; its payload is dropped.
+static int
+transact(int fd, ScratchBuffer<uint8_t, 4096>& req)
+{
+	// the arena had no room for the request
+	if (!req.capacity()) return -1;
+	*reinterpret_cast<uint32_t*>(req.data()) = htonl(req.size() - 4);
+	if (!write_full(fd, req.data(), req.size())) return -1;
+	std::array<uint8_t, 64> resp;
+	if (!read_full(fd, resp.data(), 5)) return -1;
+	uint32_t len = ntohl(*reinterpret_cast<uint32_t*>(resp.data()));
+	if (!len) return -1;
+	const int type = resp[4];
+	for (--len; len; ) {
+		const auto n = std::min<size_t>(len, resp.size());
+		if (!read_full(fd, resp.data(), n)) return -1;
+		len -= n;
+	}
+	return type;
+}
 
 SshAgent::SshAgent()
 : fd_(socket(AF_UNIX, SOCK_STREAM, 0))
@@ -50,25 +95,35 @@ SshAgent::add(const Ed25519KeyPair& k, const char* comment)
 	return 0;
 }
 
+bool
+SshAgent::remove_oldest()
+{
+	for (size_t i = 0; i != entries_.size(); ++i) {
+		auto& item = entries_[(n_ + i) % entries_.size()];
+		if (item) {
+			item = std::experimental::nullopt;
+			return true;
+		}
+	}
+	return false;
+}
+
 SshAgent::Entry::~Entry()
 {
 	if (error()) return;
-	Buffer<uint8_t, 4096> buf;
+	ScratchBuffer<uint8_t, 4096> buf;
 	buf.append_network_long(0);
 	buf += '\x12'; // SSH2_AGENTC_REMOVE_IDENTITY
 	buf.append_network_long(0x33);
 	buf.append_with_be32_length_prefix("ssh-ed25519");
 	buf.append_with_be32_length_prefix(reinterpret_cast<const char*>(pk_.data()), pk_.size());
 	sodium_memzero(pk_.data(), pk_.size());
-	*reinterpret_cast<uint32_t*>(buf.data()) = htonl(buf.size() - 4);
-	buf.write(fd_->get()); // TODO: check return value
-	std::array<uint8_t, 8> resp;
-	const auto rd2 = read(fd_->get(), resp.data(), resp.size());
-	if (rd2 != 5 || ntohl(*reinterpret_cast<uint32_t*>(resp.data())) != 1) {
-		writes(STDERR_FILENO, "Unexpected result size from ssh-agent at removing key\n");
+	const int type = transact(fd_->get(), buf);
+	if (type < 0) {
+		writes(STDERR_FILENO, "Unexpected response from ssh-agent at removing key\n");
 		return;
 	}
-	if (resp[4] != 6) {
+	if (type != 6) {
 		writes(STDERR_FILENO, "ssh-agent did not return success at removing key\n");
 		return;
 	}
@@ -79,7 +134,7 @@ SshAgent::Entry::Entry(Fd& fd, const Ed25519KeyPair& k, const char* comment)
 , pk_(k.pub)
 {
 	if (!fd_->valid()) return;
-	Buffer<uint8_t, 4096> buf;
+	ScratchBuffer<uint8_t, 4096> buf;
 	buf.append_network_long(0);
 	buf += '\x19'; // SSH2_AGENTC_ADD_ID_CONSTRAINED
 	buf.append_with_be32_length_prefix("ssh-ed25519");
@@ -89,15 +144,12 @@ SshAgent::Entry::Entry(Fd& fd, const Ed25519KeyPair& k, const char* comment)
 	if (!access("/usr/bin/ssh-askpass", F_OK)) {
 		buf += '\x02'; // SSH_AGENT_CONSTRAIN_CONFIRM
 	}
-	*reinterpret_cast<uint32_t*>(buf.data()) = htonl(buf.size() - 4);
-	buf.write(fd_->get()); // TODO: check return value
-	std::array<uint8_t, 8> resp;
-	const auto rd = read(fd_->get(), resp.data(), resp.size());
-	if (rd != 5 || ntohl(*reinterpret_cast<uint32_t*>(resp.data())) != 1) {
-		writes(STDERR_FILENO, "Unexpected result size from ssh-agent\n");
+	const int type = transact(fd_->get(), buf);
+	if (type < 0) {
+		writes(STDERR_FILENO, "Unexpected response from ssh-agent\n");
 		return;
 	}
-	if (resp[4] == 6) error_ = 0;
+	if (type == 6) error_ = 0;
 }
 
 SshAgent::Entry::Entry(Entry&& e)
@@ -9,8 +9,6 @@
 #include <array>
 #include <experimental/optional>
 
-extern "C" std::size_t to_base64(char* dst, std::size_t dst_len, const void* src, std::size_t src_len);
-
 using Ed25519PublicKey = std::array<uint8_t, crypto_sign_ed25519_PUBLICKEYBYTES>;
 using Ed25519SecretKey = std::array<uint8_t, crypto_sign_ed25519_SECRETKEYBYTES>;
 
@@ -25,6 +23,8 @@ struct SshAgent {
 	SshAgent& operator=(const SshAgent&) = delete;
 
 	int add(const Ed25519KeyPair& k, const char* comment);
+	// removes the oldest key from the agent, false when none is left
+	bool remove_oldest();
 
 private:
 	struct Entry {
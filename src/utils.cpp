@@ -6,8 +6,14 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <cstring>
 #include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <cerrno>
 
 ssize_t
 writes(int fd, const char* s)
@@ -22,8 +28,12 @@ getenv_or(const char* name, const char* _default)
 	return value ? value : _default;
 }
 
+static int prompt_fd = STDOUT_FILENO;
+
+void set_prompt_fd(int fd) { prompt_fd = fd; }
+
 static char*
-mygetstring(const char* prompt, int infd = STDIN_FILENO, int outfd = STDOUT_FILENO)
+mygetstring(const char* prompt, int infd = STDIN_FILENO, int outfd = prompt_fd)
 {
 	static char buffer[256];
 	static int sord = 0;
@@ -93,3 +103,43 @@ mygetpass(const char* prompt)
 {
 	return HiddenInput().getpass(prompt);
 }
+
+const char*
+parse_int(const char* s, int& out)
+{
+	char* end;
+	errno = 0;
+	const long v = strtol(s, &end, 10);
+	if (end == s || errno || v < INT_MIN || v > INT_MAX) return nullptr;
+	out = v;
+	return end;
+}
+
+int
+cpu_count()
+{
+	cpu_set_t set;
+	memset(&set, 0, sizeof(set));
+	if (sched_getaffinity(0, sizeof(set), &set) < 0) return 1;
+	int n = 0;
+	for (unsigned i = 0; i != sizeof(set); ++i) {
+		for (auto b = reinterpret_cast<const unsigned char*>(&set)[i]; b; b &= b - 1) ++n;
+	}
+	return n ? n : 1;
+}
+
+void*
+map_anonymous(std::size_t size, int flags)
+{
+	void *const p = mmap(0, size, PROT_READ | PROT_WRITE, flags | MAP_ANONYMOUS, -1, 0);
+	// the raw syscall returns -errno instead of MAP_FAILED
+	return reinterpret_cast<uintptr_t>(p) > -4096UL ? nullptr : p;
+}
+
+unsigned long
+monotonic_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<unsigned long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
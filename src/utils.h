@@ -2,10 +2,18 @@
 #define SLPM_UTILS_HEADER
 
 #include <unistd.h>
+#include <cstddef>
 
 ssize_t writes(int fd, const char* s);
 const char* getenv_or(const char* name, const char* _default);
 char* getstring(const char* prompt);
+void set_prompt_fd(int fd);
 char* mygetpass(const char* prompt);
+// Parses a decimal int, returns the end of its digits or nullptr when there
+// are none or it does not fit.
+const char* parse_int(const char* s, int& out);
+int cpu_count();
+void* map_anonymous(std::size_t size, int flags);
+unsigned long monotonic_us();
 
 #endif // SLPM_UTILS_HEADER
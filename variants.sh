@@ -0,0 +1,34 @@
+#!/bin/sh
+# Usage: ./variants.sh BINARY...
+#
+# Compares build variants: the size of every binary, the time of its key
+# derivation and the average time per site over SITES generic sites (default
+# 2000) written as tsv, the key derivation left out.
+
+set -e
+
+export SLPM_FULLNAME="John Doe"
+export SLPM_FORMAT=tsv
+unset SLPM_KEYRING_TIMEOUT SLPM_PERF SLPM_SEED SLPM_KDF_PROFILE
+SITES=${SITES:-2000}
+
+now() { date +%s%N; }
+
+sites() {
+	echo "correct horse battery staple"
+	for i in `seq $1`; do
+		printf 'site-%d.example\n1\n' $i
+	done
+}
+
+printf '%-24s %10s %8s %12s\n' binary bytes kdf-ms us-per-site
+for bin; do
+	start=`now`
+	sites 0 | ./$bin > /dev/null 2>&1
+	kdf=$((`now` - start))
+	start=`now`
+	sites $SITES | ./$bin > /dev/null 2>&1
+	total=$((`now` - start))
+	printf '%-24s %10d %8d %12d\n' $bin `stat -c %s $bin` \
+		$((kdf / 1000000)) $(((total - kdf) / 1000 / SITES))
+done